@@ -104,6 +104,7 @@ fi
 %manifest %{name}.manifest
 %license LICENSE
 %attr(755,root,root) /usr/bin/%{name}
+%attr(755,root,root) /usr/bin/askuser-audit-read
 /usr/lib/systemd/system/%{name}.service
 
 %files -n libaskuser-common
@@ -116,9 +117,16 @@ fi
 %license LICENSE
 %{_libdir}/cynara/plugin/client/*
 %{_libdir}/cynara/plugin/service/*
+%attr(755,root,root) /usr/bin/askuser-cache-stats
+%attr(755,root,root) /usr/bin/askuser-span-dump
 
 %files -n askuser-test
 %manifest askuser-test.manifest
 %license LICENSE
 %attr(755,root,root) /usr/bin/askuser-test-client
+%attr(755,root,root) /usr/bin/askuser-test-alloc
+%attr(755,root,root) /usr/bin/askuser-test-plugin-host
+%attr(755,root,root) /usr/bin/askuser-test-cache-bench
+%attr(755,root,root) /usr/bin/askuser-test-replay
+%attr(755,root,root) /usr/bin/askuser-test-soak
 %attr(755,root,root) /usr/bin/askuser-test.sh
@@ -0,0 +1,468 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+/**
+ * @file        AuditLog.cpp
+ * @author      Adam Malinowski <a.malinowsk2@partner.samsung.com>
+ * @brief       This file implements writer of binary audit log of decisions
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+#include <log/alog.h>
+
+#include "AuditLog.h"
+
+namespace AskUser {
+
+namespace Agent {
+
+namespace {
+
+const std::chrono::seconds syncInterval(1);
+const mode_t logMode = 0640;
+const mode_t logDirMode = 0750;
+
+std::string rotatedPath(const std::string &path, unsigned index) {
+    return path + "." + std::to_string(index);
+}
+
+std::uint64_t wallTime() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void createParentDir(const std::string &path) {
+    auto slash = path.rfind('/');
+    if (slash == std::string::npos || slash == 0) {
+        return;
+    }
+    // Only the last directory is created, its parent is expected to exist
+    mkdir(path.substr(0, slash).c_str(), logDirMode);
+}
+
+} // namespace
+
+AuditLog::AuditLog() : m_maxSize(DEFAULT_MAX_SIZE), m_maxAge(0), m_keep(DEFAULT_KEEP), m_fd(-1),
+                       m_dictionary(nullptr), m_size(0), m_firstTime(0), m_nextLogId(0),
+                       m_failed(false), m_dropped(0), m_stopping(false) {}
+
+AuditLog::~AuditLog() {
+    close();
+}
+
+bool AuditLog::open(const std::string &path, std::size_t maxSize, unsigned maxAge,
+                    unsigned keep) {
+    m_path = path;
+    m_maxSize = std::max(maxSize, sizeof(Audit::FileHeader) + sizeof(Audit::Record));
+    m_maxAge = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::seconds(maxAge)).count();
+    m_keep = keep;
+
+    createParentDir(m_path);
+    if (!openFiles()) {
+        closeFiles();
+        return false;
+    }
+
+    m_queued.reserve(BATCH_SIZE);
+    m_stopping = false;
+    m_thread = std::thread(&AuditLog::run, this);
+    ALOGD("Decisions are audited in <" << m_path << ">");
+    return true;
+}
+
+void AuditLog::close() {
+    if (!m_thread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_event.notify_one();
+    m_thread.join();
+    closeFiles();
+}
+
+void AuditLog::record(Intern::Id client, Intern::Id user, Intern::Id privilege,
+                      Cynara::PolicyType answer, Audit::Outcome outcome,
+                      Trace::Timestamp received) {
+    if (!m_thread.joinable()) {
+        return;
+    }
+
+    Audit::Record record;
+    record.time = wallTime();
+    record.client = client;
+    record.user = user;
+    record.privilege = privilege;
+    record.latency = static_cast<std::uint32_t>((Trace::now() - received) / 1000000);
+    record.answer = answer;
+    record.outcome = outcome;
+    memset(record.reserved, 0, sizeof(record.reserved));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_queued.size() >= MAX_QUEUED) {
+        ++m_dropped;
+        return;
+    }
+    m_queued.push_back(record);
+    // Writer wakes up by itself once per sync interval, unless batch is full
+    if (m_queued.size() == BATCH_SIZE) {
+        m_event.notify_one();
+    }
+}
+
+void AuditLog::run() {
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+
+    std::vector<Audit::Record> batch;
+    batch.reserve(BATCH_SIZE);
+    m_lastSync = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_event.wait_for(lock, syncInterval, [this] {
+            return m_stopping || m_queued.size() >= BATCH_SIZE;
+        });
+        bool stopping = m_stopping;
+        std::size_t dropped = m_dropped;
+        m_dropped = 0;
+        batch.swap(m_queued);
+        lock.unlock();
+
+        if (dropped) {
+            ALOGW("Audit log falls behind, [" << dropped << "] decisions dropped");
+        }
+        if (!batch.empty()) {
+            write(batch);
+            batch.clear();
+        }
+        if (stopping || std::chrono::steady_clock::now() - m_lastSync >= syncInterval) {
+            sync();
+        }
+
+        lock.lock();
+        if (stopping && m_queued.empty()) {
+            break;
+        }
+    }
+}
+
+// Log left by previous run is continued, unless it is broken or due for rotation
+bool AuditLog::openFiles() {
+    struct stat st;
+    if (stat(m_path.c_str(), &st) == 0 && st.st_size > 0) {
+        if (resumeFiles() && !isDue(wallTime())) {
+            return true;
+        }
+        closeFiles();
+        rotate();
+    }
+    return createFiles();
+}
+
+bool AuditLog::resumeFiles() {
+    m_fd = TEMP_FAILURE_RETRY(::open(m_path.c_str(), O_RDWR | O_CLOEXEC));
+    if (m_fd < 0) {
+        int erryes = errno;
+        ALOGE("Unable to open audit log <" << m_path << ">: <" << strerror(erryes) << ">");
+        return false;
+    }
+    Audit::FileHeader header;
+    struct stat st;
+    if (TEMP_FAILURE_RETRY(pread(m_fd, &header, sizeof(header), 0))
+            != static_cast<ssize_t>(sizeof(header))
+        || header.magic != Audit::FileHeader::MAGIC
+        || header.version != Audit::FileHeader::VERSION
+        || header.recordSize != sizeof(Audit::Record) || fstat(m_fd, &st) != 0) {
+        ALOGE("Audit log <" << m_path << "> cannot be continued, it is rotated");
+        return false;
+    }
+
+    // Record torn by crash of previous run is dropped
+    std::size_t records = (st.st_size - sizeof(header)) / sizeof(Audit::Record);
+    m_size = sizeof(header) + records * sizeof(Audit::Record);
+    Audit::Record first;
+    if ((m_size != static_cast<std::size_t>(st.st_size) && ftruncate(m_fd, m_size) != 0)
+        || (records && TEMP_FAILURE_RETRY(pread(m_fd, &first, sizeof(first), sizeof(header)))
+                       != static_cast<ssize_t>(sizeof(first)))) {
+        int erryes = errno;
+        ALOGE("Unable to continue audit log <" << m_path << ">: <" << strerror(erryes) << ">");
+        return false;
+    }
+    m_firstTime = records ? first.time : 0;
+
+    std::string dictionaryPath = Audit::dictionaryPath(m_path);
+    if (!loadDictionary(dictionaryPath)) {
+        return false;
+    }
+    int dictionaryFd = TEMP_FAILURE_RETRY(::open(dictionaryPath.c_str(),
+                                                 O_WRONLY | O_APPEND | O_CLOEXEC));
+    m_dictionary = dictionaryFd >= 0 ? fdopen(dictionaryFd, "a") : nullptr;
+    if (!m_dictionary) {
+        int erryes = errno;
+        if (dictionaryFd >= 0) {
+            ::close(dictionaryFd);
+        }
+        ALOGE("Unable to open audit dictionary <" << dictionaryPath << ">: <"
+              << strerror(erryes) << ">");
+        return false;
+    }
+    m_logIds.clear();
+    m_failed = false;
+    return true;
+}
+
+// Line torn by crash of previous run is dropped, so appended lines do not continue it
+bool AuditLog::loadDictionary(const std::string &dictionaryPath) {
+    m_loadedIds.clear();
+    m_nextLogId = 0;
+    FILE *file = fopen(dictionaryPath.c_str(), "re");
+    if (!file) {
+        int erryes = errno;
+        ALOGE("Unable to open audit dictionary <" << dictionaryPath << ">: <"
+              << strerror(erryes) << ">");
+        return false;
+    }
+    char *line = nullptr;
+    std::size_t capacity = 0;
+    ssize_t length;
+    off_t complete = 0;
+    bool valid = true;
+    while ((length = getline(&line, &capacity, file)) > 0 && line[length - 1] == '\n') {
+        char *end;
+        errno = 0;
+        unsigned long id = strtoul(line, &end, 10);
+        std::string value;
+        if (errno || end == line || *end != ' ' || id >= UINT32_MAX
+            || !Audit::unescapeValue(std::string(end + 1, line + length - 1), value)) {
+            valid = false;
+            break;
+        }
+        m_loadedIds.insert(std::make_pair(std::move(value), static_cast<std::uint32_t>(id)));
+        m_nextLogId = std::max(m_nextLogId, static_cast<std::uint32_t>(id + 1));
+        complete += length;
+    }
+    free(line);
+    fclose(file);
+
+    if (!valid) {
+        ALOGE("Audit dictionary <" << dictionaryPath << "> is malformed");
+        return false;
+    }
+    if (length > 0 && truncate(dictionaryPath.c_str(), complete) != 0) {
+        int erryes = errno;
+        ALOGE("Unable to truncate audit dictionary <" << dictionaryPath << ">: <"
+              << strerror(erryes) << ">");
+        return false;
+    }
+    return true;
+}
+
+bool AuditLog::createFiles() {
+    m_fd = TEMP_FAILURE_RETRY(::open(m_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                                     logMode));
+    if (m_fd < 0) {
+        int erryes = errno;
+        ALOGE("Unable to create audit log <" << m_path << ">: <" << strerror(erryes) << ">");
+        return false;
+    }
+    std::string dictionaryPath = Audit::dictionaryPath(m_path);
+    int dictionaryFd = TEMP_FAILURE_RETRY(::open(dictionaryPath.c_str(),
+                                                 O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                                                 logMode));
+    m_dictionary = dictionaryFd >= 0 ? fdopen(dictionaryFd, "w") : nullptr;
+    if (!m_dictionary) {
+        int erryes = errno;
+        if (dictionaryFd >= 0) {
+            ::close(dictionaryFd);
+        }
+        ALOGE("Unable to create audit dictionary <" << dictionaryPath << ">: <"
+              << strerror(erryes) << ">");
+        return false;
+    }
+
+    Audit::FileHeader header;
+    header.magic = Audit::FileHeader::MAGIC;
+    header.version = Audit::FileHeader::VERSION;
+    header.recordSize = sizeof(Audit::Record);
+    header.reserved = 0;
+    if (TEMP_FAILURE_RETRY(::write(m_fd, &header, sizeof(header)))
+            != static_cast<ssize_t>(sizeof(header))) {
+        int erryes = errno;
+        ALOGE("Unable to write audit log <" << m_path << ">: <" << strerror(erryes) << ">");
+        return false;
+    }
+    m_size = sizeof(header);
+    m_firstTime = 0;
+    m_logIds.clear();
+    m_loadedIds.clear();
+    m_nextLogId = 0;
+    m_failed = false;
+    return true;
+}
+
+void AuditLog::closeFiles() {
+    if (m_dictionary) {
+        fclose(m_dictionary);
+        m_dictionary = nullptr;
+    }
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+bool AuditLog::isDue(std::uint64_t now) const {
+    return m_size + sizeof(Audit::Record) > m_maxSize
+           || (m_maxAge && m_firstTime && now - std::min(now, m_firstTime) >= m_maxAge);
+}
+
+void AuditLog::rotate() {
+    for (unsigned index = m_keep; index > 0; --index) {
+        std::string from = index > 1 ? rotatedPath(m_path, index - 1) : m_path;
+        std::string to = rotatedPath(m_path, index);
+        rename(from.c_str(), to.c_str());
+        rename(Audit::dictionaryPath(from).c_str(), Audit::dictionaryPath(to).c_str());
+    }
+    if (!m_keep) {
+        unlink(m_path.c_str());
+        unlink(Audit::dictionaryPath(m_path).c_str());
+    }
+}
+
+void AuditLog::write(std::vector<Audit::Record> &batch) {
+    std::size_t done = 0;
+    while (done < batch.size()) {
+        if (m_fd < 0) {
+            ALOGE("Audit log is not open, [" << batch.size() - done << "] decisions lost");
+            return;
+        }
+        std::size_t room = (m_maxSize - m_size) / sizeof(Audit::Record);
+        if (isDue(batch[done].time)) {
+            sync();
+            closeFiles();
+            rotate();
+            if (!createFiles()) {
+                closeFiles();
+            }
+            continue;
+        }
+        std::size_t count = std::min(room, batch.size() - done);
+        writeRecords(batch.data() + done, count);
+        done += count;
+    }
+}
+
+void AuditLog::writeRecords(Audit::Record *records, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+        records[i].client = logId(records[i].client);
+        records[i].user = logId(records[i].user);
+        records[i].privilege = logId(records[i].privilege);
+    }
+    // Dictionary must not be behind records using it
+    if (fflush(m_dictionary) != 0) {
+        fail("dictionary");
+        return;
+    }
+
+    // Records are written at m_size, so a torn write is overwritten by the next one
+    const char *data = reinterpret_cast<const char *>(records);
+    std::size_t size = count * sizeof(Audit::Record);
+    std::size_t done = 0;
+    while (done < size) {
+        ssize_t written = TEMP_FAILURE_RETRY(pwrite(m_fd, data + done, size - done,
+                                                    m_size + done));
+        if (written <= 0) {
+            break;
+        }
+        done += written;
+    }
+    if (done >= sizeof(Audit::Record) && !m_firstTime) {
+        m_firstTime = records[0].time;
+    }
+    m_size += done - done % sizeof(Audit::Record);
+    if (done < size) {
+        fail("log");
+        // Part of record is cut off, so readers do not see it
+        if (done % sizeof(Audit::Record) && ftruncate(m_fd, m_size) != 0) {
+            fail("log");
+        }
+        return;
+    }
+    m_failed = false;
+}
+
+// Value written by previous run keeps its id, new value gets the next free one
+std::uint32_t AuditLog::logId(Intern::Id id) {
+    if (id >= m_logIds.size()) {
+        m_logIds.resize(id + 1, 0);
+    }
+    if (m_logIds[id]) {
+        return m_logIds[id] - 1;
+    }
+    const std::string &value = Intern::value(id);
+    std::uint32_t logId;
+    auto it = m_loadedIds.find(value);
+    if (it != m_loadedIds.end()) {
+        logId = it->second;
+        m_loadedIds.erase(it);
+    } else {
+        logId = m_nextLogId++;
+        fprintf(m_dictionary, "%u %s\n", logId, Audit::escapeValue(value).c_str());
+    }
+    m_logIds[id] = logId + 1;
+    return logId;
+}
+
+void AuditLog::sync() {
+    m_lastSync = std::chrono::steady_clock::now();
+    if (m_dictionary && fdatasync(fileno(m_dictionary)) != 0) {
+        fail("dictionary");
+    }
+    if (m_fd >= 0 && fdatasync(m_fd) != 0) {
+        fail("log");
+    }
+}
+
+// Logged once until the next successful write, so broken storage does not flood journal
+void AuditLog::fail(const char *what) {
+    int erryes = errno;
+    if (m_failed) {
+        return;
+    }
+    m_failed = true;
+    ALOGE("Unable to write audit " << what << " <" << m_path << ">: <" << strerror(erryes)
+          << ">");
+}
+
+} // namespace Agent
+
+} // namespace AskUser
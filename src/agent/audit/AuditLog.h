@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+/**
+ * @file        AuditLog.h
+ * @author      Adam Malinowski <a.malinowsk2@partner.samsung.com>
+ * @brief       This file declares writer of binary audit log of decisions
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <audit/AuditRecord.h>
+#include <intern/InternTable.h>
+#include <trace/SpanRing.h>
+#include <types/PolicyType.h>
+
+namespace AskUser {
+
+namespace Agent {
+
+/*
+ * Decisions are queued by agent thread and appended to log by writer thread in batches.
+ * Log is synced at most once per SYNC_INTERVAL and rotated when it reaches its size limit or
+ * its first decision is older than its age limit, keeping given number of older logs as
+ * "<log>.1" (the newest) to "<log>.<keep>". Records refer to ids of log dictionary, not to
+ * interned ids, so log left by previous run is continued. At most MAX_QUEUED decisions wait
+ * for writer, when storage falls behind further ones are dropped and their count is logged.
+ */
+class AuditLog {
+public:
+    static const std::size_t DEFAULT_MAX_SIZE = 8 * 1024 * 1024;
+    static const unsigned DEFAULT_MAX_AGE = 7 * 24 * 60 * 60; // seconds, zero is no limit
+    static const unsigned DEFAULT_KEEP = 4;
+    static const std::size_t BATCH_SIZE = 256;
+    static const std::size_t MAX_QUEUED = 16 * BATCH_SIZE;
+
+    AuditLog();
+    ~AuditLog();
+
+    bool open(const std::string &path, std::size_t maxSize = DEFAULT_MAX_SIZE,
+              unsigned maxAge = DEFAULT_MAX_AGE, unsigned keep = DEFAULT_KEEP);
+    // Writes and syncs all queued decisions
+    void close();
+    // Callers intern identifiers only if decisions are audited
+    bool isOpen() const {
+        return m_thread.joinable();
+    }
+
+    void record(Intern::Id client, Intern::Id user, Intern::Id privilege,
+                Cynara::PolicyType answer, Audit::Outcome outcome, Trace::Timestamp received);
+
+private:
+    std::string m_path;
+    std::size_t m_maxSize;
+    std::uint64_t m_maxAge; // nanoseconds
+    unsigned m_keep;
+    int m_fd;
+    FILE *m_dictionary;
+    std::size_t m_size;
+    std::uint64_t m_firstTime; // of the first record in current log, zero if there is none
+    std::vector<std::uint32_t> m_logIds; // dictionary id + 1 per interned id, zero if unknown
+    std::unordered_map<std::string, std::uint32_t> m_loadedIds; // left by previous run
+    std::uint32_t m_nextLogId;
+    std::chrono::steady_clock::time_point m_lastSync;
+    bool m_failed;
+
+    std::mutex m_mutex;
+    std::condition_variable m_event;
+    std::vector<Audit::Record> m_queued;
+    std::size_t m_dropped; // since writer took the last batch
+    bool m_stopping;
+    std::thread m_thread;
+
+    void run();
+    bool openFiles();
+    bool resumeFiles();
+    bool loadDictionary(const std::string &dictionaryPath);
+    bool createFiles();
+    void closeFiles();
+    bool isDue(std::uint64_t now) const;
+    void rotate();
+    void write(std::vector<Audit::Record> &batch);
+    void writeRecords(Audit::Record *records, std::size_t count);
+    std::uint32_t logId(Intern::Id id);
+    void sync();
+    void fail(const char *what);
+};
+
+} // namespace Agent
+
+} // namespace AskUser
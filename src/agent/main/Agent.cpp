@@ -19,22 +19,23 @@
  * @brief       This file implements main class of ask user agent
  */
 
+#include <algorithm>
 #include <chrono>
 #include <cstdlib>
+#include <limits>
+#include <malloc.h>
 #include <memory>
-#include <sstream>
 #include <string>
 #include <unistd.h>
 #include <utility>
 
 #include <attributes/attributes.h>
+#include <intern/InternTable.h>
 #include <translator/Translator.h>
 #include <types/AgentErrorMsg.h>
-#include <types/SupportedTypes.h>
 
 #include <log/alog.h>
-#include <ui/AskUINotificationBackend.h>
-
+#include <main/PhaseTimer.h>
 #include "Agent.h"
 
 namespace AskUser {
@@ -43,70 +44,177 @@ namespace Agent {
 
 volatile sig_atomic_t Agent::m_stopFlag = 0;
 
-Agent::Agent() : m_cynaraTalker([&](Request *request) -> void { requestHandler(request); }) {
+namespace {
+const char *const rulesPath = ASKUSER_CONF_DIR "/rules";
+const char *const snapshotPath = "/run/askuser-prompts";
+const char *const auditLogPath = "/var/log/askuser/audit.log";
+const std::chrono::milliseconds defaultBatchWindow(100);
+const std::chrono::milliseconds maxWaitTime(1000);
+const std::chrono::milliseconds defaultStallThreshold(500);
+
+const char *rulesFile() {
+    char *rules = getenv("ASKUSER_RULES");
+    return rules ? rules : rulesPath;
+}
+}
+
+Agent::Agent(AskUIFactory &uiFactory) : m_uiFactory(uiFactory), m_cynaraTalker(*this),
+                 m_incomingRequests(RequestPool::DEFAULT_SIZE), m_rules(rulesFile()),
+                 m_snapshotPath(snapshotPath), m_snapshotDirty(false), m_spans(nullptr),
+                 m_watchdog("agent"),
+                 m_workerContext{m_uiFactory, m_cynaraTalker, m_requestPool,
+                                 PromptWorkers::DEFAULT_COUNT, m_audit, nullptr,
+                                 defaultBatchWindow, true,
+                                 [this] { waitForWarmup(); }, [this] { snapshotChanged(); },
+                                 [this](RequestId id) { requestAnswered(id); }} {
     init();
 }
 
 Agent::~Agent() {
     finish();
+    Trace::unmapSpanRing(m_spans);
 }
 
 void Agent::init() {
-    // TODO: implement if needed
+    PhaseTimer timer("init");
+
+    char *batchWindow = getenv("ASKUSER_BATCH_WINDOW_MS");
+    if (batchWindow) {
+        m_workerContext.batchWindow = std::chrono::milliseconds(strtoul(batchWindow, nullptr,
+                                                                        10));
+    }
+    ALOGD("Requests are batched within window of [" << m_workerContext.batchWindow.count()
+          << "] ms");
+
+    char *workers = getenv("ASKUSER_PROMPT_WORKERS");
+    if (workers) {
+        m_workerContext.promptWorkers = strtoul(workers, nullptr, 10);
+    }
+
+    char *trace = getenv("ASKUSER_TRACE");
+    if (trace) {
+        m_cynaraTalker.traceTo(trace);
+    }
+
+    m_spans = Trace::mapSpanRing("agent", true);
+    if (!m_spans) {
+        ALOGW("Unable to map ring of spans, requests will not be traced");
+    }
+    m_workerContext.spans = m_spans;
+
+    // Empty path disables audit
+    char *auditLog = getenv("ASKUSER_AUDIT_LOG");
+    std::string auditPath = auditLog ? auditLog : auditLogPath;
+    if (!auditPath.empty() && !m_audit.open(auditPath)) {
+        ALOGW("Decisions will not be audited");
+    }
+
+    std::chrono::milliseconds stallThreshold = defaultStallThreshold;
+    char *stall = getenv("ASKUSER_STALL_MS");
+    if (stall) {
+        stallThreshold = std::chrono::milliseconds(strtoul(stall, nullptr, 10));
+    }
+
+    std::size_t userWorkers = UserWorker::DEFAULT_COUNT;
+    char *users = getenv("ASKUSER_USER_WORKERS");
+    if (users) {
+        userWorkers = std::max<std::size_t>(strtoul(users, nullptr, 10), 1);
+    }
+    userWorkers = std::min<std::size_t>(userWorkers, std::numeric_limits<std::uint16_t>::max());
+    m_requestWorkers.reset(new std::atomic<std::uint16_t>[
+                               std::numeric_limits<RequestId>::max() + 1]());
+    for (std::size_t i = 0; i < userWorkers; ++i) {
+        m_workers.emplace_back(new UserWorker(m_workerContext, i));
+        m_watchdog.watch(m_workers.back()->watchdog());
+    }
+    m_workerUsers.assign(userWorkers, 0);
+
+    // Empty path disables snapshot, prompts are then lost on restart
+    char *snapshot = getenv("ASKUSER_SNAPSHOT");
+    if (snapshot) {
+        m_snapshotPath = snapshot;
+    }
+    m_workerContext.promptSnapshots = !m_snapshotPath.empty();
+
+    // Restored prompts are given to workers of their users before workers start
+    restoreSnapshot();
+
+    for (auto &worker : m_workers) {
+        worker->start(stallThreshold);
+    }
+    m_watchdog.start(stallThreshold);
+    ALOGD("Requests are handled by [" << userWorkers << "] user workers");
 
     ALOGD("Agent daemon initialized");
 }
 
-void Agent::run() {
-    m_cynaraTalker.start();
+bool Agent::start() {
+    // Loading of UI dependencies does not need to delay readiness of agent
+    m_warmup = std::thread([this] {
+                   sigset_t mask;
+                   sigemptyset(&mask);
+                   sigaddset(&mask, SIGTERM);
+                   sigprocmask(SIG_BLOCK, &mask, nullptr);
+
+                   PhaseTimer timer("UI warmup");
+                   m_uiFactory.warmUp();
+               });
+
+    PhaseTimer timer("cynara connection");
+    if (!m_cynaraTalker.start() || !m_cynaraTalker.waitForConnection()) {
+        ALOGE("Agent could not connect to cynara");
+        return false;
+    }
+    return true;
+}
 
+// Called by workers before they create prompts
+void Agent::waitForWarmup() {
+    std::lock_guard<std::mutex> lock(m_warmupMutex);
+    if (m_warmup.joinable()) {
+        m_warmup.join();
+    }
+}
+
+void Agent::run() {
     while (!m_stopFlag) {
         std::unique_lock<std::mutex> lock(m_mutex);
-        m_event.wait_for(lock, std::chrono::milliseconds(1000));
+        m_event.wait_for(lock, std::min(maxWaitTime, m_watchdog.timeToPing()));
 
         if (m_stopFlag) {
             break;
         }
 
-        while (!m_incomingRequests.empty() || !m_incomingResponses.empty()) {
-
-            if (!m_incomingRequests.empty()) {
-                Request *request = m_incomingRequests.front();
-                m_incomingRequests.pop();
-                lock.unlock();
-
-                ALOGD("Request popped from queue:"
-                     " type [" << request->type() << "],"
-                     " id [" << request->id() << "],"
-                     " data length [" << request->data().size() << "]");
-
-                if (request->type() == RT_Close) {
-                    delete request;
-                    m_stopFlag = 1;
-                    break;
-                }
-
-                processCynaraRequest(request);
-
-                lock.lock();
-            }
-
-            if (!m_incomingResponses.empty()) {
-                Response response = m_incomingResponses.front();
-                m_incomingResponses.pop();
-                lock.unlock();
+        lock.unlock();
+        m_watchdog.enter(LoopPhase::Maintenance);
+        m_rules.reloadIfChanged();
+        watchMemoryPressure();
+        if (m_snapshotDirty) {
+            saveSnapshot();
+        }
+        m_watchdog.iterationDone();
+        lock.lock();
 
-                ALOGD("Response popped from queue:"
-                     " type [" << response.type() << "],"
-                     " id [" << response.id() << "]");
+        // Every request is an iteration of its own, so watchdog is pinged under sustained load
+        while (!m_incomingRequests.empty()) {
+            Request *request = m_incomingRequests.front();
+            m_incomingRequests.pop();
+            lock.unlock();
 
-                processUIResponse(response);
+            m_watchdog.enter(LoopPhase::Requests);
+            ALOGD("Request popped from queue:"
+                 " type [" << request->type() << "],"
+                 " id [" << request->id() << "],"
+                 " data length [" << request->data().size() << "]");
 
-                lock.lock();
+            if (request->type() == RT_Close) {
+                m_requestPool.release(request);
+                m_stopFlag = 1;
+                break;
             }
 
-            lock.unlock();
-            cleanupUIThreads();
+            routeRequest(request);
+            m_watchdog.iterationDone();
             lock.lock();
         }
     }
@@ -120,151 +228,189 @@ void Agent::finish() {
         quick_exit(EXIT_SUCCESS);
     }
 
+    waitForWarmup();
+    // Workers are watched, so they stop first
+    for (auto &worker : m_workers) {
+        worker->stop();
+    }
+    m_watchdog.stop();
+
+    // Before waiting for UI threads, which may not stop in time
+    saveSnapshot();
+
     while (!m_incomingRequests.empty()) {
         Request *request = m_incomingRequests.front();
         m_incomingRequests.pop();
-        delete request;
+        m_requestPool.release(request);
     }
 
-    if (!cleanupUIThreads()) {
+    for (auto &worker : m_workers) {
+        worker->finish();
+    }
+
+    m_audit.close();
+
+    bool uiStopped = true;
+    for (auto &worker : m_workers) {
+        uiStopped = worker->cleanupUIThreads() && uiStopped;
+    }
+    if (!uiStopped) {
         ALOGE("At least one of UI threads could not be stopped. Calling quick_exit()");
         quick_exit(EXIT_SUCCESS);
     }
 
-    for (auto it = m_requests.begin(); it != m_requests.end();) {
-        delete it->second;
-        it = m_requests.erase(it);
-    }
+    m_rules.logHitCounters();
 
     ALOGD("Agent daemon has stopped commonly");
 }
 
-void Agent::requestHandler(Request *request) {
+void Agent::handleRequest(RequestType type, RequestId id, const void *data,
+                          std::size_t dataSize) {
     ALOGD("Cynara request received:"
-         " type [" << request->type() << "],"
-         " id [" << request->id() << "],"
-         " data length: [" << request->data().size() << "]");
+         " type [" << type << "],"
+         " id [" << id << "],"
+         " data length: [" << dataSize << "]");
 
+    Request *request = m_requestPool.acquire(type, id, data, dataSize);
     std::unique_lock<std::mutex> lock(m_mutex);
     m_incomingRequests.push(request);
     m_event.notify_one();
 }
 
-void Agent::processCynaraRequest(Request *request) {
-    std::unique_ptr<Request> requestPtr(request);
-
-    auto existingRequest = m_requests.find(request->id());
-    if (existingRequest != m_requests.end()) {
-        if (request->type() == RT_Cancel) {
-            delete existingRequest->second;
-            m_requests.erase(existingRequest);
-            m_cynaraTalker.sendResponse(request->type(), request->id());
-            dismissUI(request->id());
-        } else {
-            ALOGE("Incoming request with ID: [" << request->id() << "] is being already processed");
+void Agent::routeRequest(Request *request) {
+    PooledRequestPtr requestPtr(request, RequestReleaser{&m_requestPool});
+    Trace::Timestamp popped = Trace::now();
+
+    if (request->type() == RT_Cancel) {
+        std::size_t worker = m_requestWorkers[request->id()].exchange(0);
+        if (!worker) {
+            ALOGE("Cancel request for unknown request: ID: [" << request->id() << "]");
+            return;
         }
+        m_workers[worker - 1]->pushRequest(requestPtr.release());
         return;
     }
 
-    if (request->type() == RT_Cancel) {
-        ALOGE("Cancel request for unknown request: ID: [" << request->id() << "]");
+    // Decoded into request itself, so worker gets it without decoding it again
+    RequestData &data = request->requestData();
+    try {
+        Translator::Agent::dataToRequest(request->data().data(), request->data().size(), data);
+    } catch (const Translator::TranslateErrorException &e) {
+        ALOGE("Malformed request ID: [" << request->id() << "]: <" << e.what() << ">");
+        Translator::Agent::answerToData(Cynara::PolicyType(), AgentErrorMsg::Error, m_answer);
+        m_cynaraTalker.sendResponse(RT_Action, request->id(), m_answer);
         return;
     }
 
-    if (!startUIForRequest(request)) {
-        auto data = Translator::Agent::answerToData(Cynara::PolicyType(), AgentErrorMsg::Error);
-        m_cynaraTalker.sendResponse(RT_Action, request->id(), data);
+    Cynara::PolicyType decision;
+    if (m_rules.match(data, decision)) {
+        Translator::Agent::answerToData(decision, AgentErrorMsg::NoError, m_answer);
+        m_cynaraTalker.sendResponse(RT_Action, request->id(), m_answer);
+        Trace::recordSpan(m_spans, "agent.queue", data.correlationId, request->received(),
+                          popped);
+        Trace::recordSpan(m_spans, "agent.rules", data.correlationId, popped, Trace::now());
+        if (m_audit.isOpen()) {
+            m_audit.record(Intern::intern(data.client), Intern::intern(data.user),
+                           Intern::intern(data.privilege), decision, Audit::Outcome::Rule,
+                           request->received());
+        }
         return;
     }
 
-    m_requests.insert(std::make_pair(request->id(), request));
-    requestPtr.release();
+    std::size_t worker = workerFor(data.user);
+    m_requestWorkers[request->id()] = worker + 1;
+    m_workers[worker]->pushRequest(requestPtr.release());
 }
 
-void Agent::processUIResponse(const Response &response) {
-    auto requestIt = m_requests.find(response.id());
-    if (requestIt != m_requests.end()) {
-        Cynara::PluginData pluginData;
-        if (response.type() == URT_ERROR) {
-            pluginData = Translator::Agent::answerToData(Cynara::PolicyType(),
-                                                         AgentErrorMsg::Error);
-        } else if (response.type() == URT_TIMEOUT) {
-            pluginData = Translator::Agent::answerToData(Cynara::PolicyType(),
-                                                         AgentErrorMsg::Timeout);
-        } else {
-            pluginData = Translator::Agent::answerToData(
-                                            UIResponseToPolicyType(response.type()),
-                                                                   AgentErrorMsg::NoError);
-        }
-        m_cynaraTalker.sendResponse(RT_Action, requestIt->second->id(), pluginData);
-        delete requestIt->second;
-        m_requests.erase(requestIt);
+void Agent::requestAnswered(RequestId id) {
+    m_requestWorkers[id] = 0;
+}
+
+// New user is given to worker serving the fewest users
+std::size_t Agent::workerFor(const std::string &user) {
+    auto it = m_userWorkers.find(user);
+    if (it != m_userWorkers.end()) {
+        return it->second;
     }
 
-    dismissUI(response.id());
+    auto least = std::min_element(m_workerUsers.begin(), m_workerUsers.end());
+    std::size_t worker = least - m_workerUsers.begin();
+    ++*least;
+    m_userWorkers.insert(std::make_pair(user, worker));
+    ALOGD("User <" << user << "> is served by worker [" << worker << "]");
+    return worker;
 }
 
-bool Agent::startUIForRequest(Request *request) {
-    auto data = Translator::Agent::dataToRequest(request->data());
-    AskUIInterfacePtr ui(new AskUINotificationBackend());
-
-    auto handler = [&](RequestId requestId, UIResponseType resultType) -> void {
-                       UIResponseHandler(requestId, resultType);
-                   };
-    bool ret = ui->start(data.client, data.user, data.privilege, request->id(), handler);
-    if (ret) {
-        m_UIs.insert(std::make_pair(request->id(), std::move(ui)));
+void Agent::restoreSnapshot() {
+    std::vector<PromptRecord> prompts;
+    if (m_snapshotPath.empty() || !loadPromptSnapshot(m_snapshotPath, prompts)) {
+        return;
     }
 
-    return ret;
+    auto now = std::chrono::system_clock::now();
+    std::size_t restored = 0;
+    for (auto &prompt : prompts) {
+        if (prompt.expiry <= now) {
+            continue;
+        }
+        std::size_t worker = workerFor(prompt.user);
+        m_workers[worker]->restorePrompt(std::move(prompt));
+        ++restored;
+    }
+    ALOGI("Restored [" << restored << "] prompts from snapshot");
 }
 
-void Agent::UIResponseHandler(RequestId requestId, UIResponseType responseType) {
-    ALOGD("UI response received: type [" << responseType << "], id [" << requestId << "]");
-
+// Called by workers, once they publish changed prompts
+void Agent::snapshotChanged() {
     std::unique_lock<std::mutex> lock(m_mutex);
-    m_incomingResponses.push(Response(requestId, responseType));
+    m_snapshotDirty = true;
     m_event.notify_one();
 }
 
-bool Agent::cleanupUIThreads() {
-    bool ret = true;
-    for (auto it = m_UIs.begin(); it != m_UIs.end();) {
-        if (it->second->isDismissing() && it->second->dismiss()) {
-            it = m_UIs.erase(it);
-        } else {
-            ret = false;
-            ++it;
-        }
+// Prompts published by workers are merged into one snapshot
+void Agent::saveSnapshot() {
+    m_snapshotDirty = false;
+    if (m_snapshotPath.empty()) {
+        return;
+    }
+    std::vector<PromptRecord> published;
+    for (auto &worker : m_workers) {
+        worker->snapshotPrompts(published);
     }
-    return ret;
-}
 
-void Agent::dismissUI(RequestId requestId) {
-    auto it = m_UIs.find(requestId);
-    if (it != m_UIs.end()) {
-        if (it->second->dismiss()) {
-            it = m_UIs.erase(it);
+    auto now = std::chrono::system_clock::now();
+    std::vector<PromptRecord> prompts;
+    for (auto &prompt : published) {
+        if (prompt.expiry > now) {
+            prompts.push_back(std::move(prompt));
         }
     }
+
+    if (!savePromptSnapshot(m_snapshotPath, prompts)) {
+        m_snapshotDirty = true;
+    }
 }
 
-Cynara::PolicyType Agent::UIResponseToPolicyType(UIResponseType responseType) {
-    switch (responseType) {
-        case URT_YES_ONCE:
-            return AskUser::SupportedTypes::Client::ALLOW_ONCE;
-        case URT_YES_SESSION:
-            return AskUser::SupportedTypes::Client::ALLOW_PER_SESSION;
-        case URT_YES_LIFE:
-            return AskUser::SupportedTypes::Client::ALLOW_PER_LIFE;
-        case URT_NO_ONCE:
-            return AskUser::SupportedTypes::Client::DENY_ONCE;
-        case URT_NO_SESSION:
-            return AskUser::SupportedTypes::Client::DENY_PER_SESSION;
-        case URT_NO_LIFE:
-            return AskUser::SupportedTypes::Client::DENY_PER_LIFE;
-        default:
-            return AskUser::SupportedTypes::Client::DENY_ONCE;
+/*
+ * Memory freed by finished prompts (notification backends, their threads and translated
+ * strings) stays in heap of the process. Under memory pressure idle requests pooled after
+ * bursts are freed too and all of it is returned to the system.
+ */
+void Agent::watchMemoryPressure() {
+    switch (m_memoryPressure.poll()) {
+    case Pressure::MemoryPressure::Transition::Started: {
+        std::size_t freed = m_requestPool.shrink();
+        ALOGD("Freed [" << freed << "] idle pooled requests");
+        bool released = malloc_trim(0);
+        ALOGI("Memory pressure started, free heap memory "
+              << (released ? "returned to system" : "not available"));
+        break;
+    }
+    case Pressure::MemoryPressure::Transition::Ended:
+        ALOGI("Memory pressure ended");
+        break;
+    case Pressure::MemoryPressure::Transition::None:
+        break;
     }
 }
 
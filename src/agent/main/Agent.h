@@ -21,16 +21,31 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <csignal>
+#include <cstddef>
+#include <cstdint>
 #include <map>
+#include <memory>
 #include <mutex>
-#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+#include <pressure/MemoryPressure.h>
+#include <trace/SpanRing.h>
 #include <types/PolicyType.h>
 
+#include <audit/AuditLog.h>
 #include <main/CynaraTalker.h>
+#include <main/LoopWatchdog.h>
+#include <main/PromptSnapshot.h>
 #include <main/Request.h>
-#include <main/Response.h>
+#include <main/RequestPool.h>
+#include <main/RingQueue.h>
+#include <main/UserWorker.h>
+#include <rules/RuleMatcher.h>
 
 #include <ui/AskUIInterface.h>
 
@@ -38,11 +53,18 @@ namespace AskUser {
 
 namespace Agent {
 
-class Agent {
+/*
+ * Agent loop decodes requests from cynara and answers these matched by rules. Others are
+ * routed to workers by user, so every user is served by one worker, while prompts of users
+ * of different workers do not wait for each other.
+ */
+class Agent : private RequestSink {
 public:
-    Agent();
+    explicit Agent(AskUIFactory &uiFactory);
     ~Agent();
 
+    // Connects to cynara, returns when agent is ready to serve requests
+    bool start();
     void run();
 
     static void stop() {
@@ -50,28 +72,51 @@ public:
     }
 
 private:
+    AskUIFactory &m_uiFactory;
     CynaraTalker m_cynaraTalker;
-    std::map<RequestId, Request *> m_requests;
-    std::queue<Request *> m_incomingRequests;
-    std::queue<Response> m_incomingResponses;
+    RequestPool m_requestPool;
+    RingQueue<Request *> m_incomingRequests;
+    // Reused by every request, so answering does not allocate
+    Cynara::PluginData m_answer;
     std::condition_variable m_event;
     std::mutex m_mutex;
     static volatile sig_atomic_t m_stopFlag;
-    std::map<RequestId, AskUIInterfacePtr> m_UIs;
+    RuleMatcher m_rules;
+    Pressure::MemoryPressure m_memoryPressure;
+    std::thread m_warmup;
+    std::mutex m_warmupMutex;
+    std::string m_snapshotPath;
+    // Set by workers, when prompts they publish for snapshot change
+    std::atomic<bool> m_snapshotDirty;
+    Trace::SpanRing *m_spans;
+    AuditLog m_audit;
+    LoopWatchdog m_watchdog;
+
+    WorkerContext m_workerContext;
+    std::vector<std::unique_ptr<UserWorker>> m_workers;
+    // Users are assigned to workers on their first request and never move
+    std::map<std::string, std::size_t> m_userWorkers;
+    std::vector<std::size_t> m_workerUsers; // number of users of every worker
+    /*
+     * Worker of every request not answered yet plus one, 0 for none, so cancels follow their
+     * requests. Indexed by ID, so routing neither allocates nor takes a lock.
+     */
+    std::unique_ptr<std::atomic<std::uint16_t>[]> m_requestWorkers;
 
     void init();
     void finish();
-
-    void requestHandler(Request *request);
-    void processCynaraRequest(Request *request);
-    bool startUIForRequest(Request *request);
-    void UIResponseHandler(RequestId requestId, UIResponseType responseType);
-
-    void processUIResponse(const Response &response);
-    bool cleanupUIThreads();
-    void dismissUI(RequestId requestId);
-
-    static Cynara::PolicyType UIResponseToPolicyType(UIResponseType responseType);
+    void waitForWarmup();
+
+    virtual void handleRequest(RequestType type, RequestId id, const void *data,
+                               std::size_t dataSize);
+    void routeRequest(Request *request);
+    void requestAnswered(RequestId id);
+    std::size_t workerFor(const std::string &user);
+    void watchMemoryPressure();
+
+    void restoreSnapshot();
+    void snapshotChanged();
+    void saveSnapshot();
 };
 
 } // namespace Agent
@@ -73,22 +73,29 @@ namespace AskUser {
 
 namespace Agent {
 
-CynaraTalker::CynaraTalker(RequestHandler requestHandler) : m_requestHandler(requestHandler),
-                                                            m_cynara(nullptr) {
+CynaraTalker::CynaraTalker(RequestSink &requestSink) : m_requestSink(requestSink),
+                                                      m_cynara(nullptr) {
     m_future = m_threadFinished.get_future();
+    m_connectedFuture = m_connected.get_future();
 }
 
 bool CynaraTalker::start() {
-    if (!m_requestHandler) {
-        ALOGE("Empty request handler!");
-        return false;
-    }
-
     m_thread = std::thread(&CynaraTalker::run, this);
     return true;
 }
 
+bool CynaraTalker::waitForConnection() {
+    return m_connectedFuture.get();
+}
+
+bool CynaraTalker::traceTo(const std::string &path) {
+    return m_trace.open(path);
+}
+
 bool CynaraTalker::stop() {
+    // Agent may have to quick_exit() if thread does not stop
+    m_trace.flush();
+
     // There is no possibility to stop this thread nicely when it waits for requests from cynara
     // We can only try to get rid of thread
     auto status = m_future.wait_for(std::chrono::milliseconds(10));
@@ -115,9 +122,12 @@ void CynaraTalker::run() {
     ret = cynara_agent_initialize(&m_cynara, SupportedTypes::Agent::AgentType);
     if (ret != CYNARA_API_SUCCESS) {
         ALOGE("Initialization of cynara structure failed with error: [" << ret << "]");
-        m_requestHandler(new Request(RT_Close, 0, nullptr, 0)); // Notify agent he should die
+        m_connected.set_value(false);
+        m_threadFinished.set_value(true);
+        m_requestSink.handleRequest(RT_Close, 0, nullptr, 0); // Notify agent he should die
         return;
     }
+    m_connected.set_value(true);
 
     void *data = nullptr;
 
@@ -130,13 +140,14 @@ void CynaraTalker::run() {
             ret = cynara_agent_get_request(m_cynara, &req_type, &req_id, &data, &data_size);
             if (ret != CYNARA_API_SUCCESS) {
                 ALOGE("Receiving request from cynara failed with error: [" << ret << "]");
-                m_requestHandler(new Request(RT_Close, 0, nullptr, 0));
+                m_requestSink.handleRequest(RT_Close, 0, nullptr, 0);
                 break;
             }
 
             try {
-                m_requestHandler(new Request(cynaraType2AgentType(req_type), req_id, data,
-                                             data_size));
+                RequestType type = cynaraType2AgentType(req_type);
+                m_trace.request(type, req_id, data, data_size);
+                m_requestSink.handleRequest(type, req_id, data, data_size);
             } catch (const TypeException &e) {
                 ALOGE("TypeException: <" << e.what() << "> Request dropped!");
             }
@@ -185,6 +196,7 @@ bool CynaraTalker::sendResponse(RequestType requestType, RequestId requestId,
         return false;
     }
 
+    m_trace.response(requestType, requestId, data);
     return true;
 }
 
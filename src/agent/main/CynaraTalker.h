@@ -21,7 +21,6 @@
 
 #pragma once
 
-#include <functional>
 #include <future>
 #include <mutex>
 #include <thread>
@@ -30,31 +29,45 @@
 #include <cynara-plugin.h>
 
 #include <main/Request.h>
+#include <main/RequestTrace.h>
 
 namespace AskUser {
 
 namespace Agent {
 
-typedef std::function<void(Request *)> RequestHandler;
+// Receives requests in cynara thread, data is valid only during the call
+class RequestSink {
+public:
+    virtual ~RequestSink() {}
+    virtual void handleRequest(RequestType type, RequestId id, const void *data,
+                               std::size_t dataSize) = 0;
+};
 
 class CynaraTalker {
 public:
-    CynaraTalker(RequestHandler requestHandler);
+    CynaraTalker(RequestSink &requestSink);
     ~CynaraTalker() {}
 
     bool start();
     bool stop();
+    // Blocks until connection to cynara is established or failed
+    bool waitForConnection();
+    // Records all requests and responses to given file, must be called before start()
+    bool traceTo(const std::string &path);
 
     bool sendResponse(RequestType requestType, RequestId requestId,
                       const Cynara::PluginData &data = Cynara::PluginData());
 
 private:
-    RequestHandler m_requestHandler;
+    RequestSink &m_requestSink;
     cynara_agent *m_cynara;
     std::thread m_thread;
     std::mutex m_mutex;
     std::promise<bool> m_threadFinished;
     std::future<bool> m_future;
+    std::promise<bool> m_connected;
+    std::future<bool> m_connectedFuture;
+    RequestTraceWriter m_trace;
 
     void run();
 };
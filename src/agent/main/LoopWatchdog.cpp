@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+/**
+ * @file        LoopWatchdog.cpp
+ * @author      Adam Malinowski <a.malinowsk2@partner.samsung.com>
+ * @brief       This file implements watchdog of agent main loop
+ */
+
+#include <algorithm>
+#include <csignal>
+#include <cstdlib>
+#include <systemd/sd-daemon.h>
+#include <unistd.h>
+
+#include <log/alog.h>
+
+#include "LoopWatchdog.h"
+
+namespace AskUser {
+
+namespace Agent {
+
+namespace {
+
+double toMs(LoopWatchdog::Clock::duration duration) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(duration).count() / 1000.0;
+}
+
+std::int64_t toNs(LoopWatchdog::Clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+} // namespace
+
+LoopWatchdog::LoopWatchdog(const std::string &name) : m_name(name),
+                               m_pingInterval(Clock::duration::zero()),
+                               m_stallThreshold(Clock::duration::zero()), m_stuckReported(false),
+                               m_phase(LoopPhase::Idle), m_currentPhase(0),
+                               m_currentPhaseStart(0), m_phaseCount(0), m_stopping(false) {
+    m_durations.fill(Clock::duration::zero());
+}
+
+LoopWatchdog::~LoopWatchdog() {
+    stop();
+}
+
+void LoopWatchdog::watch(const LoopWatchdog &loop) {
+    m_watched.push_back(&loop);
+}
+
+// Same as sd_watchdog_enabled(), which is not provided by older libsystemd-daemon
+void LoopWatchdog::start(std::chrono::milliseconds stallThreshold, bool supervise) {
+    m_stallThreshold = stallThreshold;
+    if (!supervise) {
+        return;
+    }
+
+    char *usec = getenv("WATCHDOG_USEC");
+    char *pid = getenv("WATCHDOG_PID");
+    if (usec && (!pid || strtoul(pid, nullptr, 10) == static_cast<unsigned long>(getpid()))) {
+        // Pinging twice per watchdog period leaves margin for scheduling delays
+        m_pingInterval = std::chrono::microseconds(strtoull(usec, nullptr, 10) / 2);
+        ALOGD("Watchdog is pinged every [" << toMs(m_pingInterval) << "] ms");
+    }
+    m_nextPing = Clock::now() + m_pingInterval;
+
+    if (m_stallThreshold > Clock::duration::zero()) {
+        m_stopping = false;
+        m_monitor = std::thread(&LoopWatchdog::monitor, this);
+    }
+}
+
+void LoopWatchdog::stop() {
+    if (!m_monitor.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_event.notify_one();
+    m_monitor.join();
+}
+
+void LoopWatchdog::enter(LoopPhase phase) {
+    auto now = Clock::now();
+    if (m_phase == LoopPhase::Idle) {
+        m_iterationStart = now;
+    } else {
+        m_durations[static_cast<std::size_t>(m_phase)] += now - m_phaseStart;
+    }
+    m_phase = phase;
+    m_phaseStart = now;
+
+    m_currentPhaseStart.store(toNs(now), std::memory_order_relaxed);
+    m_currentPhase.store(static_cast<int>(phase), std::memory_order_relaxed);
+    m_phaseCount.fetch_add(1, std::memory_order_release);
+}
+
+void LoopWatchdog::iterationDone() {
+    enter(LoopPhase::Idle);
+    auto now = m_phaseStart;
+    auto duration = now - m_iterationStart;
+
+    if (m_stallThreshold > Clock::duration::zero() && duration > m_stallThreshold) {
+        auto longest = std::max_element(m_durations.begin(), m_durations.end());
+        LoopPhase phase = static_cast<LoopPhase>(longest - m_durations.begin());
+        ALOGW("Loop <" << m_name << "> iteration took [" << toMs(duration) << "] ms, phase <"
+              << phaseName(phase) << "> took [" << toMs(*longest) << "] ms");
+        for (std::size_t i = 1; i < m_durations.size(); ++i) {
+            ALOGD("Phase <" << phaseName(static_cast<LoopPhase>(i)) << "> took ["
+                  << toMs(m_durations[i]) << "] ms");
+        }
+    }
+    m_durations.fill(Clock::duration::zero());
+
+    if (m_pingInterval > Clock::duration::zero() && now >= m_nextPing) {
+        if (watchedResponsive(now)) {
+            ping(now);
+        } else {
+            m_nextPing = now + m_pingInterval / 4;
+        }
+    }
+}
+
+std::chrono::milliseconds LoopWatchdog::timeToPing() const {
+    if (m_pingInterval == Clock::duration::zero()) {
+        return std::chrono::milliseconds::max();
+    }
+    auto now = Clock::now();
+    if (now >= m_nextPing) {
+        return std::chrono::milliseconds::zero();
+    }
+    return std::chrono::duration_cast<std::chrono::milliseconds>(m_nextPing - now);
+}
+
+const char *LoopWatchdog::phaseName(LoopPhase phase) {
+    switch (phase) {
+    case LoopPhase::Idle:
+        return "idle";
+    case LoopPhase::Maintenance:
+        return "maintenance";
+    case LoopPhase::Prompts:
+        return "prompt start";
+    case LoopPhase::Requests:
+        return "request processing";
+    case LoopPhase::Responses:
+        return "response processing";
+    case LoopPhase::UICleanup:
+        return "UI cleanup";
+    case LoopPhase::Count:
+        break;
+    }
+    return "unknown";
+}
+
+bool LoopWatchdog::runningPhase(Clock::time_point now, LoopPhase &phase,
+                                Clock::duration &running) const {
+    phase = static_cast<LoopPhase>(m_currentPhase.load(std::memory_order_relaxed));
+    if (phase == LoopPhase::Idle) {
+        return false;
+    }
+    running = std::chrono::nanoseconds(toNs(now)
+                                       - m_currentPhaseStart.load(std::memory_order_relaxed));
+    return true;
+}
+
+// Loop busy in one phase for whole ping interval is considered stuck
+bool LoopWatchdog::watchedResponsive(Clock::time_point now) {
+    for (auto loop : m_watched) {
+        LoopPhase phase;
+        Clock::duration running;
+        if (!loop->runningPhase(now, phase, running) || running < m_pingInterval) {
+            continue;
+        }
+        if (!m_stuckReported) {
+            ALOGE("Loop <" << loop->m_name << "> is stuck in phase <" << phaseName(phase)
+                  << ">, watchdog is not pinged");
+            m_stuckReported = true;
+        }
+        return false;
+    }
+    m_stuckReported = false;
+    return true;
+}
+
+void LoopWatchdog::ping(Clock::time_point now) {
+    m_nextPing = now + m_pingInterval;
+    int ret = sd_notify(0, "WATCHDOG=1");
+    if (ret < 0) {
+        ALOGE("sd_notify failed: [" << ret << "]");
+    }
+}
+
+// Logs every phase once, when it runs beyond stall threshold
+void LoopWatchdog::monitor() {
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+
+    std::vector<const LoopWatchdog *> loops(1, this);
+    loops.insert(loops.end(), m_watched.begin(), m_watched.end());
+    std::vector<std::uint64_t> reported(loops.size(), 0);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_event.wait_for(lock, m_stallThreshold / 2, [this] { return m_stopping; })) {
+        auto now = Clock::now();
+        for (std::size_t i = 0; i < loops.size(); ++i) {
+            std::uint64_t count = loops[i]->m_phaseCount.load(std::memory_order_acquire);
+            LoopPhase phase;
+            Clock::duration running;
+            if (count == reported[i] || !loops[i]->runningPhase(now, phase, running)
+                || running <= m_stallThreshold) {
+                continue;
+            }
+            ALOGW("Loop <" << loops[i]->m_name << "> is stalled in phase <" << phaseName(phase)
+                  << "> for [" << toMs(running) << "] ms");
+            reported[i] = count;
+        }
+    }
+}
+
+} // namespace Agent
+
+} // namespace AskUser
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+/**
+ * @file        LoopWatchdog.h
+ * @author      Adam Malinowski <a.malinowsk2@partner.samsung.com>
+ * @brief       This file declares watchdog of agent main loop
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace AskUser {
+
+namespace Agent {
+
+enum class LoopPhase : int {
+    Idle,        // waiting for events
+    Maintenance, // rules, memory pressure, starting prompts, deadlines and snapshot
+    Prompts,     // handling prompts started by workers
+    Requests,    // processing requests from cynara
+    Responses,   // processing answers of prompts
+    UICleanup,   // dismissing finished prompts
+    Count
+};
+
+/*
+ * Loop marks phases it goes through. Iterations longer than stall threshold are logged with
+ * time spent in each phase. Watchdog of main loop pings systemd watchdog after its completed
+ * iterations, if service has one, so agent wedged in any phase is restarted. It stops pinging
+ * while any of watched loops of workers is stuck in one phase. Its monitor thread logs phase
+ * of any of these loops which is still running beyond the threshold, as wedged iteration
+ * never completes.
+ */
+class LoopWatchdog {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    explicit LoopWatchdog(const std::string &name);
+    ~LoopWatchdog();
+
+    // Must be called before start(), loop has to outlive this watchdog
+    void watch(const LoopWatchdog &loop);
+    // Threshold 0 disables stall detection. Watchdog of worker loop neither pings systemd
+    // nor runs monitor thread, its stalls are reported by watchdog watching it.
+    void start(std::chrono::milliseconds stallThreshold, bool supervise = true);
+    void stop();
+
+    void enter(LoopPhase phase);
+    void iterationDone();
+
+    // Loop must not wait for events longer than this, so watchdog is pinged in time
+    std::chrono::milliseconds timeToPing() const;
+
+    static const char *phaseName(LoopPhase phase);
+
+private:
+    std::string m_name;
+    std::vector<const LoopWatchdog *> m_watched;
+    Clock::duration m_pingInterval;
+    Clock::time_point m_nextPing;
+    Clock::duration m_stallThreshold;
+    bool m_stuckReported;
+
+    // Owned by loop thread
+    LoopPhase m_phase;
+    Clock::time_point m_phaseStart;
+    Clock::time_point m_iterationStart;
+    std::array<Clock::duration, static_cast<std::size_t>(LoopPhase::Count)> m_durations;
+
+    // Read by monitor thread and by watchdog watching this loop
+    std::atomic<int> m_currentPhase;
+    std::atomic<std::int64_t> m_currentPhaseStart; // nanoseconds of Clock
+    std::atomic<std::uint64_t> m_phaseCount;
+
+    std::mutex m_mutex;
+    std::condition_variable m_event;
+    bool m_stopping;
+    std::thread m_monitor;
+
+    bool runningPhase(Clock::time_point now, LoopPhase &phase, Clock::duration &running) const;
+    bool watchedResponsive(Clock::time_point now);
+    void ping(Clock::time_point now);
+    void monitor();
+};
+
+} // namespace Agent
+
+} // namespace AskUser
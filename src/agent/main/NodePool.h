@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+/**
+ * @file        NodePool.h
+ * @author      Adam Malinowski <a.malinowsk2@partner.samsung.com>
+ * @brief       This file defines allocator reusing nodes of node based containers
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace AskUser {
+
+namespace Agent {
+
+/*
+ * Nodes freed by container are kept and given to its next insert, so in steady state map or
+ * set does not allocate. Pool serves nodes of one container, it must outlive the container
+ * and it is not thread safe. Nodes are freed with the pool.
+ */
+class NodePool {
+public:
+    NodePool() : m_size(0) {}
+    NodePool(const NodePool &) = delete;
+    NodePool &operator=(const NodePool &) = delete;
+
+    ~NodePool() {
+        for (void *node : m_free) {
+            ::operator delete(node);
+        }
+    }
+
+    void *allocate(std::size_t size) {
+        if (size == m_size && !m_free.empty()) {
+            void *node = m_free.back();
+            m_free.pop_back();
+            return node;
+        }
+        return ::operator new(size);
+    }
+
+    void deallocate(void *node, std::size_t size) {
+        if (!m_size) {
+            m_size = size;
+        }
+        if (size != m_size) {
+            ::operator delete(node);
+            return;
+        }
+        try {
+            m_free.push_back(node);
+        } catch (const std::bad_alloc &) {
+            ::operator delete(node);
+        }
+    }
+
+private:
+    std::size_t m_size;
+    std::vector<void *> m_free;
+};
+
+template <typename T>
+class NodeAllocator {
+public:
+    typedef T value_type;
+    typedef T *pointer;
+    typedef const T *const_pointer;
+    typedef T &reference;
+    typedef const T &const_reference;
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+
+    template <typename U>
+    struct rebind {
+        typedef NodeAllocator<U> other;
+    };
+
+    explicit NodeAllocator(NodePool &pool) : m_pool(&pool) {}
+
+    template <typename U>
+    NodeAllocator(const NodeAllocator<U> &other) : m_pool(other.pool()) {}
+
+    T *allocate(std::size_t count) {
+        if (count != 1) {
+            return static_cast<T *>(::operator new(count * sizeof(T)));
+        }
+        return static_cast<T *>(m_pool->allocate(sizeof(T)));
+    }
+
+    void deallocate(T *node, std::size_t count) {
+        if (count != 1) {
+            ::operator delete(node);
+            return;
+        }
+        m_pool->deallocate(node, sizeof(T));
+    }
+
+    template <typename U, typename... Args>
+    void construct(U *object, Args&&... args) {
+        ::new(static_cast<void *>(object)) U(std::forward<Args>(args)...);
+    }
+
+    template <typename U>
+    void destroy(U *object) {
+        object->~U();
+    }
+
+    std::size_t max_size() const {
+        return static_cast<std::size_t>(-1) / sizeof(T);
+    }
+
+    NodePool *pool() const {
+        return m_pool;
+    }
+
+private:
+    NodePool *m_pool;
+};
+
+template <typename T, typename U>
+bool operator==(const NodeAllocator<T> &lhs, const NodeAllocator<U> &rhs) {
+    return lhs.pool() == rhs.pool();
+}
+
+template <typename T, typename U>
+bool operator!=(const NodeAllocator<T> &lhs, const NodeAllocator<U> &rhs) {
+    return lhs.pool() != rhs.pool();
+}
+
+} // namespace Agent
+
+} // namespace AskUser
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+/**
+ * @file        PhaseTimer.h
+ * @author      Adam Malinowski <a.malinowsk2@partner.samsung.com>
+ * @brief       This file defines timer logging duration of startup phases
+ */
+
+#pragma once
+
+#include <chrono>
+
+#include <log/alog.h>
+
+namespace AskUser {
+
+namespace Agent {
+
+// Logs time spent in scope, so regressions of agent startup are visible in journal
+class PhaseTimer {
+public:
+    PhaseTimer(const char *phase) : m_phase(phase), m_start(std::chrono::steady_clock::now()),
+                                    m_stopped(false) {}
+
+    ~PhaseTimer() {
+        stop();
+    }
+
+    // Ends phase before end of scope
+    void stop() {
+        if (m_stopped) {
+            return;
+        }
+        m_stopped = true;
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+                            std::chrono::steady_clock::now() - m_start);
+        ALOGI("Startup phase <" << m_phase << "> took [" << duration.count() / 1000.0
+              << "] ms");
+    }
+
+private:
+    const char *m_phase;
+    std::chrono::steady_clock::time_point m_start;
+    bool m_stopped;
+};
+
+} // namespace Agent
+
+} // namespace AskUser
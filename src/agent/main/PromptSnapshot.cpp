@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+/**
+ * @file        PromptSnapshot.cpp
+ * @author      Adam Malinowski <a.malinowsk2@partner.samsung.com>
+ * @brief       This file implements snapshot of prompts shown to user
+ */
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <limits>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <log/alog.h>
+
+#include "PromptSnapshot.h"
+
+/*
+ * Layout, all integers in host byte order as snapshot never leaves the device:
+ *     uint32 magic, uint32 version, uint32 prompt count
+ *     for every prompt:
+ *         int32 UI id, int64 expiry in seconds since epoch
+ *         string client, string user, uint16 privilege count, string privilege...
+ * where string is uint16 length followed by characters.
+ */
+
+namespace {
+
+const std::uint32_t snapshotMagic = 0x41534e50; // "ASNP"
+const std::uint32_t snapshotVersion = 1;
+
+template <typename T>
+void put(std::string &buffer, T value) {
+    buffer.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+bool putString(std::string &buffer, const std::string &value) {
+    if (value.size() > std::numeric_limits<std::uint16_t>::max())
+        return false;
+    put<std::uint16_t>(buffer, value.size());
+    buffer.append(value);
+    return true;
+}
+
+class Reader {
+public:
+    Reader(const std::string &buffer) : m_buffer(buffer), m_pos(0) {}
+
+    template <typename T>
+    bool get(T &value) {
+        if (m_buffer.size() - m_pos < sizeof(value))
+            return false;
+        memcpy(&value, m_buffer.data() + m_pos, sizeof(value));
+        m_pos += sizeof(value);
+        return true;
+    }
+
+    bool getString(std::string &value) {
+        std::uint16_t size;
+        if (!get(size) || m_buffer.size() - m_pos < size)
+            return false;
+        value.assign(m_buffer, m_pos, size);
+        m_pos += size;
+        return true;
+    }
+
+    bool done() const {
+        return m_pos == m_buffer.size();
+    }
+
+private:
+    const std::string &m_buffer;
+    std::size_t m_pos;
+};
+
+bool writeAll(int fd, const std::string &buffer) {
+    std::size_t written = 0;
+    while (written < buffer.size()) {
+        ssize_t ret = TEMP_FAILURE_RETRY(write(fd, buffer.data() + written,
+                                               buffer.size() - written));
+        if (ret < 0)
+            return false;
+        written += ret;
+    }
+    return true;
+}
+
+} // namespace
+
+namespace AskUser {
+
+namespace Agent {
+
+bool savePromptSnapshot(const std::string &path, const std::vector<PromptRecord> &prompts) {
+    std::string buffer;
+    put(buffer, snapshotMagic);
+    put(buffer, snapshotVersion);
+    put<std::uint32_t>(buffer, prompts.size());
+    for (const auto &prompt : prompts) {
+        put<std::int32_t>(buffer, prompt.uiId);
+        put<std::int64_t>(buffer, std::chrono::system_clock::to_time_t(prompt.expiry));
+        if (!putString(buffer, prompt.client) || !putString(buffer, prompt.user)
+                || prompt.privileges.size() > std::numeric_limits<std::uint16_t>::max()) {
+            ALOGE("Prompt [" << prompt.uiId << "] too large for snapshot");
+            return false;
+        }
+        put<std::uint16_t>(buffer, prompt.privileges.size());
+        for (const auto &privilege : prompt.privileges) {
+            if (!putString(buffer, privilege)) {
+                ALOGE("Prompt [" << prompt.uiId << "] too large for snapshot");
+                return false;
+            }
+        }
+    }
+
+    // Leftover of interrupted save is replaced, never followed nor reused
+    std::string tmpPath = path + ".tmp";
+    unlink(tmpPath.c_str());
+    int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        int erryes = errno;
+        ALOGE("Unable to create snapshot <" << tmpPath << ">: <" << strerror(erryes) << ">");
+        return false;
+    }
+    bool written = writeAll(fd, buffer);
+    written = (close(fd) == 0) && written;
+    if (!written || rename(tmpPath.c_str(), path.c_str()) < 0) {
+        int erryes = errno;
+        ALOGE("Unable to write snapshot <" << path << ">: <" << strerror(erryes) << ">");
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Prompts from snapshot are shown again on behalf of agent, so only snapshot written by agent
+ * itself is trusted: regular file owned by its user and writable by nobody else.
+ */
+bool loadPromptSnapshot(const std::string &path, std::vector<PromptRecord> &prompts) {
+    int fd = open(path.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno != ENOENT) {
+            int erryes = errno;
+            ALOGW("Unable to open snapshot <" << path << ">: <" << strerror(erryes) << ">");
+        }
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) < 0) {
+        int erryes = errno;
+        ALOGW("Unable to stat snapshot <" << path << ">: <" << strerror(erryes) << ">");
+        close(fd);
+        return false;
+    }
+    if (!S_ISREG(info.st_mode) || info.st_uid != geteuid()
+            || (info.st_mode & (S_IWGRP | S_IWOTH))) {
+        ALOGW("Snapshot <" << path << "> is not owned by agent or is writable by others");
+        close(fd);
+        return false;
+    }
+
+    std::string buffer;
+    char chunk[BUFSIZ];
+    ssize_t size;
+    while ((size = TEMP_FAILURE_RETRY(read(fd, chunk, sizeof(chunk)))) > 0)
+        buffer.append(chunk, size);
+    close(fd);
+    if (size < 0) {
+        ALOGW("Unable to read snapshot <" << path << ">");
+        return false;
+    }
+
+    Reader reader(buffer);
+    std::uint32_t magic, version, count;
+    if (!reader.get(magic) || !reader.get(version) || !reader.get(count)
+            || magic != snapshotMagic || version != snapshotVersion) {
+        ALOGW("Snapshot <" << path << "> is not valid");
+        return false;
+    }
+
+    std::vector<PromptRecord> loaded;
+    for (std::uint32_t i = 0; i < count; ++i) {
+        PromptRecord prompt;
+        std::int32_t uiId;
+        std::int64_t expiry;
+        std::uint16_t privilegeCount;
+        if (!reader.get(uiId) || !reader.get(expiry) || !reader.getString(prompt.client)
+                || !reader.getString(prompt.user) || !reader.get(privilegeCount)) {
+            ALOGW("Snapshot <" << path << "> is truncated");
+            return false;
+        }
+        prompt.uiId = uiId;
+        prompt.expiry = std::chrono::system_clock::from_time_t(expiry);
+        prompt.privileges.resize(privilegeCount);
+        for (auto &privilege : prompt.privileges) {
+            if (!reader.getString(privilege)) {
+                ALOGW("Snapshot <" << path << "> is truncated");
+                return false;
+            }
+        }
+        loaded.push_back(std::move(prompt));
+    }
+    if (!reader.done()) {
+        ALOGW("Snapshot <" << path << "> has trailing data");
+        return false;
+    }
+
+    prompts.swap(loaded);
+    return true;
+}
+
+} // namespace Agent
+
+} // namespace AskUser
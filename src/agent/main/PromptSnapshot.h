@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+/**
+ * @file        PromptSnapshot.h
+ * @author      Adam Malinowski <a.malinowsk2@partner.samsung.com>
+ * @brief       This file declares snapshot of prompts shown to user
+ */
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace AskUser {
+
+namespace Agent {
+
+// Prompt still shown to user, which agent can reattach to after restart
+struct PromptRecord {
+    int uiId;
+    std::chrono::system_clock::time_point expiry;
+    std::string client;
+    std::string user;
+    std::vector<std::string> privileges;
+};
+
+/*
+ * Snapshot is written to temporary file, readable only by agent, renamed over the previous
+ * one, so reader never sees partially written snapshot. Malformed or foreign snapshot, or one
+ * writable by anyone but agent, is rejected as a whole.
+ */
+bool savePromptSnapshot(const std::string &path, const std::vector<PromptRecord> &prompts);
+bool loadPromptSnapshot(const std::string &path, std::vector<PromptRecord> &prompts);
+
+} // namespace Agent
+
+} // namespace AskUser
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+/**
+ * @file        PromptWorkers.cpp
+ * @author      Adam Malinowski <a.malinowsk2@partner.samsung.com>
+ * @brief       This file implements pool of threads creating prompts
+ */
+
+#include <csignal>
+#include <utility>
+
+#include <log/alog.h>
+
+#include "PromptWorkers.h"
+
+namespace AskUser {
+
+namespace Agent {
+
+PromptWorkers::PromptWorkers() : m_jobs(DEFAULT_QUEUE), m_stopping(false) {}
+
+PromptWorkers::~PromptWorkers() {
+    stop();
+}
+
+void PromptWorkers::start(std::size_t count) {
+    if (!count) {
+        count = 1;
+    }
+    m_stopping = false;
+    for (std::size_t i = 0; i < count; ++i) {
+        m_threads.push_back(std::thread(&PromptWorkers::run, this));
+    }
+    ALOGD("Started [" << count << "] prompt workers");
+}
+
+void PromptWorkers::stop() {
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        while (!m_jobs.empty()) {
+            PromptJob dropped = std::move(m_jobs.front());
+            m_jobs.pop();
+        }
+    }
+    m_event.notify_all();
+
+    for (auto &thread : m_threads) {
+        thread.join();
+    }
+    m_threads.clear();
+}
+
+void PromptWorkers::submit(PromptJob job) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_jobs.push(std::move(job));
+    m_event.notify_one();
+}
+
+void PromptWorkers::run() {
+    int ret;
+    sigset_t mask;
+
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGTERM);
+    if ((ret = sigprocmask(SIG_BLOCK, &mask, nullptr)) < 0) {
+        ALOGE("sigprocmask failed [<<" << ret << "]");
+    }
+
+    while (true) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_event.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+        if (m_stopping) {
+            break;
+        }
+        PromptJob job = std::move(m_jobs.front());
+        m_jobs.pop();
+        lock.unlock();
+
+        try {
+            job.started = job.ui->start(job.client, job.user, job.privileges,
+                                        job.responseCallback);
+        } catch (const std::exception &e) {
+            ALOGE("Unexpected exception: <" << e.what() << ">");
+            job.started = false;
+        }
+        job.sink->handlePrompt(job);
+    }
+}
+
+} // namespace Agent
+
+} // namespace AskUser
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+/**
+ * @file        PromptWorkers.h
+ * @author      Adam Malinowski <a.malinowsk2@partner.samsung.com>
+ * @brief       This file declares pool of threads creating prompts
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <main/Response.h>
+#include <main/RingQueue.h>
+#include <ui/AskUIInterface.h>
+
+namespace AskUser {
+
+namespace Agent {
+
+class PromptSink;
+
+struct PromptJob {
+    std::string client;
+    std::string user;
+    std::vector<PrivilegeRequest> privileges;
+    AskUIInterfacePtr ui;
+    PromptSerial prompt;
+    UIResponseCallback responseCallback;
+    bool started;
+    PromptSink *sink; // gets job back once its prompt is started
+};
+
+// Receives jobs in worker thread, once their prompts are started or failed to start
+class PromptSink {
+public:
+    virtual ~PromptSink() {}
+    virtual void handlePrompt(PromptJob &job) = 0;
+};
+
+/*
+ * Creating prompt takes several round trips to notification service and privilege manager.
+ * Workers do it in parallel, so loop of user worker owning them does not wait for them.
+ */
+class PromptWorkers {
+public:
+    static const std::size_t DEFAULT_COUNT = 1; // per user worker
+    static const std::size_t DEFAULT_QUEUE = 8;  // jobs queued without allocating
+
+    PromptWorkers();
+    ~PromptWorkers();
+
+    void start(std::size_t count);
+    // Jobs not taken by workers yet are dropped
+    void stop();
+
+    void submit(PromptJob job);
+
+private:
+    std::vector<std::thread> m_threads;
+    RingQueue<PromptJob> m_jobs;
+    std::mutex m_mutex;
+    std::condition_variable m_event;
+    bool m_stopping;
+
+    void run();
+};
+
+} // namespace Agent
+
+} // namespace AskUser
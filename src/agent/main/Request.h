@@ -27,6 +27,9 @@
 #include <cynara-agent.h>
 #include <cynara-plugin.h>
 
+#include <trace/SpanRing.h>
+#include <types/RequestData.h>
+
 namespace AskUser {
 
 namespace Agent {
@@ -43,9 +46,25 @@ class Request {
 public:
     Request() = default;
     Request(RequestType type, RequestId id, void *data, std::size_t dataSize)
-        : m_type(type), m_id(id), m_data(static_cast<char *>(data), dataSize) {}
+        : m_type(type), m_id(id), m_data(static_cast<char *>(data), dataSize),
+          m_received(Trace::now()) {}
     ~Request() {}
 
+    void reserve(std::size_t dataSize, std::size_t fieldSize) {
+        m_data.reserve(dataSize);
+        m_requestData.client.reserve(fieldSize);
+        m_requestData.user.reserve(fieldSize);
+        m_requestData.privilege.reserve(fieldSize);
+    }
+
+    // Reuses memory of previous payload, used by RequestPool
+    void assign(RequestType type, RequestId id, const void *data, std::size_t dataSize) {
+        m_type = type;
+        m_id = id;
+        m_data.assign(static_cast<const char *>(data), dataSize);
+        m_received = Trace::now();
+    }
+
     RequestType type() const {
         return m_type;
     }
@@ -58,10 +77,21 @@ public:
         return m_data;
     }
 
+    Trace::Timestamp received() const {
+        return m_received;
+    }
+
+    // Decoded by agent to route request, so worker does not decode it again
+    RequestData &requestData() {
+        return m_requestData;
+    }
+
 private:
     RequestType m_type;
     RequestId m_id;
     Cynara::PluginData m_data;
+    Trace::Timestamp m_received;
+    RequestData m_requestData;
 };
 
 } // namespace Agent
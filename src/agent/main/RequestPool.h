@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+/**
+ * @file        RequestPool.h
+ * @author      Adam Malinowski <a.malinowsk2@partner.samsung.com>
+ * @brief       This file defines pool of preallocated requests
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <main/Request.h>
+
+namespace AskUser {
+
+namespace Agent {
+
+class RequestPool;
+
+// Deleter giving request back to its pool
+struct RequestReleaser {
+    RequestPool *pool;
+    void operator()(Request *request) const;
+};
+
+typedef std::unique_ptr<Request, RequestReleaser> PooledRequestPtr;
+
+/*
+ * Requests are taken from pool by cynara thread and given back by agent thread. Pool grows
+ * only when more requests than ever before are processed at once, so in steady state neither
+ * request objects nor their payloads are allocated. Requests beyond initial size are freed
+ * only on demand, e.g. under memory pressure.
+ */
+class RequestPool {
+public:
+    static const std::size_t DEFAULT_SIZE = 32;
+    // Payload of typical request and its decoded fields fit without reallocation
+    static const std::size_t PAYLOAD_RESERVE = 256;
+    static const std::size_t FIELD_RESERVE = 64;
+
+    explicit RequestPool(std::size_t size = DEFAULT_SIZE) {
+        m_requests.reserve(size);
+        m_free.reserve(size);
+        for (std::size_t i = 0; i < size; ++i) {
+            add();
+        }
+    }
+
+    Request *acquire(RequestType type, RequestId id, const void *data, std::size_t dataSize) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_free.empty()) {
+            add();
+        }
+        Request *request = m_free.back();
+        m_free.pop_back();
+        request->assign(type, id, data, dataSize);
+        return request;
+    }
+
+    void release(Request *request) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_free.push_back(request);
+    }
+
+    // Frees idle requests above given number, returns how many were freed
+    std::size_t shrink(std::size_t keep = DEFAULT_SIZE) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::size_t freed = 0;
+        while (m_requests.size() > keep && !m_free.empty()) {
+            Request *request = m_free.back();
+            m_free.pop_back();
+            auto it = std::find_if(m_requests.begin(), m_requests.end(),
+                                   [request](const std::unique_ptr<Request> &owned) {
+                                       return owned.get() == request;
+                                   });
+            std::swap(*it, m_requests.back());
+            m_requests.pop_back();
+            ++freed;
+        }
+        return freed;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::vector<std::unique_ptr<Request>> m_requests;
+    std::vector<Request *> m_free;
+
+    void add() {
+        std::unique_ptr<Request> request(new Request());
+        request->reserve(PAYLOAD_RESERVE, FIELD_RESERVE);
+        m_free.push_back(request.get());
+        m_requests.push_back(std::move(request));
+    }
+};
+
+inline void RequestReleaser::operator()(Request *request) const {
+    pool->release(request);
+}
+
+} // namespace Agent
+
+} // namespace AskUser
@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+/**
+ * @file        RequestTrace.cpp
+ * @author      Adam Malinowski <a.malinowsk2@partner.samsung.com>
+ * @brief       This file implements trace of requests exchanged with cynara
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <limits>
+#include <unistd.h>
+
+#include <translator/Translator.h>
+
+#include <log/alog.h>
+
+#include "RequestTrace.h"
+
+/*
+ * Layout, all integers in host byte order as trace is replayed on the same kind of machine:
+ *     uint32 magic, uint32 version
+ *     for every record:
+ *         uint8 event, uint32 request id, int64 nanoseconds since start of trace
+ *         Request: string client, string user, string privilege
+ *         Response: string answer
+ * where string is uint16 length followed by characters.
+ */
+
+namespace {
+
+const std::uint32_t traceMagic = 0x41545243; // "ATRC"
+const std::uint32_t traceVersion = 1;
+
+template <typename T>
+bool put(FILE *file, T value) {
+    return fwrite(&value, sizeof(value), 1, file) == 1;
+}
+
+bool putString(FILE *file, const std::string &value) {
+    std::uint16_t size = std::min<std::size_t>(value.size(),
+                                               std::numeric_limits<std::uint16_t>::max());
+    return put(file, size) && fwrite(value.data(), 1, size, file) == size;
+}
+
+template <typename T>
+bool get(FILE *file, T &value) {
+    return fread(&value, sizeof(value), 1, file) == 1;
+}
+
+bool getString(FILE *file, std::string &value) {
+    std::uint16_t size;
+    if (!get(file, size))
+        return false;
+    value.resize(size);
+    return !size || fread(&value[0], 1, size, file) == size;
+}
+
+} // namespace
+
+namespace AskUser {
+
+namespace Agent {
+
+RequestTraceWriter::RequestTraceWriter() : m_file(nullptr), m_enabled(false) {}
+
+RequestTraceWriter::~RequestTraceWriter() {
+    if (m_file) {
+        fclose(m_file);
+    }
+}
+
+bool RequestTraceWriter::open(const std::string &path) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // Trace holds identifiers of all requests, so it is readable only by agent and existing
+    // file, or link planted in its place, is never overwritten
+    int fd = TEMP_FAILURE_RETRY(::open(path.c_str(),
+                                       O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC,
+                                       0600));
+    if (fd < 0) {
+        int erryes = errno;
+        ALOGE("Unable to create trace <" << path << ">: <" << strerror(erryes) << ">");
+        return false;
+    }
+    m_file = fdopen(fd, "w");
+    if (!m_file) {
+        int erryes = errno;
+        ALOGE("Unable to open trace <" << path << ">: <" << strerror(erryes) << ">");
+        close(fd);
+        return false;
+    }
+    if (!put(m_file, traceMagic) || !put(m_file, traceVersion)) {
+        ALOGE("Unable to write trace <" << path << ">");
+        fclose(m_file);
+        m_file = nullptr;
+        return false;
+    }
+    m_start = std::chrono::steady_clock::now();
+    m_enabled = true;
+    ALOGI("Requests are traced to <" << path << ">");
+    return true;
+}
+
+void RequestTraceWriter::flush() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_file) {
+        fflush(m_file);
+    }
+}
+
+void RequestTraceWriter::request(RequestType type, RequestId id, const void *data,
+                                 std::size_t dataSize) {
+    if (!m_enabled) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file) {
+        return;
+    }
+    TraceRecord record;
+    record.id = id;
+    if (type == RT_Cancel) {
+        record.event = TraceEvent::Cancel;
+    } else {
+        record.event = TraceEvent::Request;
+        try {
+            Translator::Agent::dataToRequest(static_cast<const char *>(data), dataSize,
+                                             record.request);
+        } catch (const Translator::TranslateErrorException &e) {
+            ALOGW("Malformed request ID: [" << id << "] not traced");
+            return;
+        }
+    }
+    write(record);
+}
+
+void RequestTraceWriter::response(RequestType type, RequestId id,
+                                  const Cynara::PluginData &data) {
+    if (!m_enabled) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file) {
+        return;
+    }
+    TraceRecord record;
+    record.event = type == RT_Cancel ? TraceEvent::CancelResponse : TraceEvent::Response;
+    record.id = id;
+    record.answer = data;
+    write(record);
+}
+
+void RequestTraceWriter::write(const TraceRecord &record) {
+    auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - m_start);
+    bool written = put(m_file, static_cast<std::uint8_t>(record.event))
+                && put<std::uint32_t>(m_file, record.id)
+                && put<std::int64_t>(m_file, time.count());
+    if (written && record.event == TraceEvent::Request) {
+        written = putString(m_file, record.request.client)
+               && putString(m_file, record.request.user)
+               && putString(m_file, record.request.privilege);
+    } else if (written && record.event == TraceEvent::Response) {
+        written = putString(m_file, record.answer);
+    }
+
+    if (!written) {
+        ALOGE("Unable to write trace, tracing stopped");
+        m_enabled = false;
+        fclose(m_file);
+        m_file = nullptr;
+    }
+}
+
+RequestTraceReader::RequestTraceReader() : m_file(nullptr) {}
+
+RequestTraceReader::~RequestTraceReader() {
+    if (m_file) {
+        fclose(m_file);
+    }
+}
+
+bool RequestTraceReader::open(const std::string &path) {
+    m_file = fopen(path.c_str(), "re");
+    if (!m_file) {
+        int erryes = errno;
+        ALOGE("Unable to open trace <" << path << ">: <" << strerror(erryes) << ">");
+        return false;
+    }
+    std::uint32_t magic, version;
+    if (!get(m_file, magic) || !get(m_file, version)
+            || magic != traceMagic || version != traceVersion) {
+        ALOGE("Trace <" << path << "> is not valid");
+        return false;
+    }
+    return true;
+}
+
+bool RequestTraceReader::next(TraceRecord &record) {
+    std::uint8_t event;
+    std::uint32_t id;
+    std::int64_t time;
+    if (!m_file || !get(m_file, event)) {
+        return false;
+    }
+    if (event > static_cast<std::uint8_t>(TraceEvent::CancelResponse)
+            || !get(m_file, id) || !get(m_file, time)) {
+        ALOGW("Trace is truncated");
+        return false;
+    }
+
+    record.event = static_cast<TraceEvent>(event);
+    record.id = id;
+    record.time = std::chrono::nanoseconds(time);
+    record.request = RequestData();
+    record.answer.clear();
+    bool complete = true;
+    if (record.event == TraceEvent::Request) {
+        complete = getString(m_file, record.request.client)
+                && getString(m_file, record.request.user)
+                && getString(m_file, record.request.privilege);
+    } else if (record.event == TraceEvent::Response) {
+        complete = getString(m_file, record.answer);
+    }
+    if (!complete) {
+        ALOGW("Trace is truncated");
+    }
+    return complete;
+}
+
+} // namespace Agent
+
+} // namespace AskUser
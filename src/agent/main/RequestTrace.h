@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+/**
+ * @file        RequestTrace.h
+ * @author      Adam Malinowski <a.malinowsk2@partner.samsung.com>
+ * @brief       This file declares trace of requests exchanged with cynara
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+#include <cynara-plugin.h>
+#include <types/RequestData.h>
+
+#include <main/Request.h>
+
+namespace AskUser {
+
+namespace Agent {
+
+enum class TraceEvent : std::uint8_t {
+    Request,
+    Cancel,
+    Response,
+    CancelResponse
+};
+
+struct TraceRecord {
+    TraceEvent event;
+    RequestId id;
+    std::chrono::nanoseconds time; // since start of trace
+    RequestData request;           // only for Request
+    Cynara::PluginData answer;     // only for Response
+};
+
+/*
+ * Records requests received from cynara and responses sent back, so traffic of a device can
+ * be replayed later. Disabled writer costs a single check per request.
+ */
+class RequestTraceWriter {
+public:
+    RequestTraceWriter();
+    ~RequestTraceWriter();
+
+    // Creates new trace, existing file is never overwritten
+    bool open(const std::string &path);
+    void flush();
+
+    void request(RequestType type, RequestId id, const void *data, std::size_t dataSize);
+    void response(RequestType type, RequestId id, const Cynara::PluginData &data);
+
+private:
+    FILE *m_file;
+    std::atomic<bool> m_enabled;
+    std::mutex m_mutex;
+    std::chrono::steady_clock::time_point m_start;
+
+    void write(const TraceRecord &record);
+};
+
+class RequestTraceReader {
+public:
+    RequestTraceReader();
+    ~RequestTraceReader();
+
+    bool open(const std::string &path);
+    // Returns false at end of trace or when trace is truncated
+    bool next(TraceRecord &record);
+
+private:
+    FILE *m_file;
+};
+
+} // namespace Agent
+
+} // namespace AskUser
@@ -28,13 +28,20 @@ namespace AskUser {
 
 namespace Agent {
 
+// Distinguishes prompts of requests, as cynara reuses IDs of answered requests
+typedef unsigned long PromptSerial;
+
 class Response {
 public:
     Response() = default;
-    Response(RequestId requestId, UIResponseType responseType) : m_id(requestId),
-                                                                 m_type(responseType) {}
+    Response(PromptSerial prompt, RequestId requestId, UIResponseType responseType)
+        : m_prompt(prompt), m_id(requestId), m_type(responseType) {}
     ~Response() {}
 
+    PromptSerial prompt() const {
+        return m_prompt;
+    }
+
     RequestId id() const {
         return m_id;
     }
@@ -44,6 +51,7 @@ public:
     }
 
 private:
+    PromptSerial m_prompt;
     RequestId m_id;
     UIResponseType m_type;
 };
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+/**
+ * @file        RingQueue.h
+ * @author      Adam Malinowski <a.malinowsk2@partner.samsung.com>
+ * @brief       This file defines queue kept in preallocated ring buffer
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace AskUser {
+
+namespace Agent {
+
+// Subset of std::queue interface; memory is allocated only when queue outgrows its capacity
+template <typename T>
+class RingQueue {
+public:
+    explicit RingQueue(std::size_t capacity) : m_items(std::max<std::size_t>(capacity, 1)),
+                                               m_head(0), m_size(0) {}
+
+    bool empty() const {
+        return m_size == 0;
+    }
+
+    std::size_t size() const {
+        return m_size;
+    }
+
+    void push(T item) {
+        if (m_size == m_items.size()) {
+            grow();
+        }
+        m_items[(m_head + m_size) % m_items.size()] = std::move(item);
+        ++m_size;
+    }
+
+    T &front() {
+        return m_items[m_head];
+    }
+
+    void pop() {
+        m_head = (m_head + 1) % m_items.size();
+        --m_size;
+    }
+
+private:
+    std::vector<T> m_items;
+    std::size_t m_head;
+    std::size_t m_size;
+
+    void grow() {
+        std::vector<T> items(m_items.size() * 2);
+        for (std::size_t i = 0; i < m_size; ++i) {
+            items[i] = std::move(m_items[(m_head + i) % m_items.size()]);
+        }
+        m_items.swap(items);
+        m_head = 0;
+    }
+};
+
+} // namespace Agent
+
+} // namespace AskUser
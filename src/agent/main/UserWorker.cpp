@@ -0,0 +1,739 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+/**
+ * @file        UserWorker.cpp
+ * @author      Adam Malinowski <a.malinowsk2@partner.samsung.com>
+ * @brief       This file implements loop handling requests of users assigned to it
+ */
+
+#include <algorithm>
+#include <csignal>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include <translator/Translator.h>
+#include <types/AgentErrorMsg.h>
+#include <types/SupportedTypes.h>
+
+#include <log/alog.h>
+
+#include "UserWorker.h"
+
+namespace AskUser {
+
+namespace Agent {
+
+namespace {
+const std::chrono::milliseconds maxWaitTime(1000);
+// Dismissed UI may finish its thread later, without any event waking us up
+const std::chrono::milliseconds uiCleanupInterval(100);
+// Prompt reports timeout by itself, deadline only guards against prompt which never answers
+const std::chrono::seconds deadlineGrace(5);
+// Jobs kept for reuse, prompts started at once beyond that allocate their jobs
+const std::size_t spareJobs = 8;
+}
+
+UserWorker::UserWorker(WorkerContext &context, std::size_t index)
+    : m_context(context), m_index(index), m_incomingRequests(RequestPool::DEFAULT_SIZE),
+      m_incomingResponses(RequestPool::DEFAULT_SIZE),
+      m_startedPrompts(PromptWorkers::DEFAULT_QUEUE), m_stopping(false),
+      m_watchdog("worker " + std::to_string(index)),
+      m_requests(std::less<RequestId>(), ActiveRequests::allocator_type(m_requestNodes)),
+      m_deadlines(std::less<Deadline>(), NodeAllocator<Deadline>(m_deadlineNodes)),
+      m_lastPrompt(0), m_snapshotDirty(false) {
+    m_spareJobs.reserve(spareJobs);
+    m_pendingPrompts.reserve(spareJobs);
+    // Dismissed prompts finish soon, so only few of them wait for their threads
+    m_finishedUIs.reserve(RequestPool::DEFAULT_SIZE);
+}
+
+UserWorker::~UserWorker() {
+    stop();
+}
+
+void UserWorker::start(std::chrono::milliseconds stallThreshold) {
+    m_watchdog.start(stallThreshold, false);
+    m_stopping = false;
+    m_thread = std::thread(&UserWorker::run, this);
+    m_promptWorkers.start(m_context.promptWorkers);
+}
+
+void UserWorker::stop() {
+    if (!m_thread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_event.notify_one();
+    m_thread.join();
+    // Prompts started after loop stopped are left in queue for finish()
+    m_promptWorkers.stop();
+
+    if (m_snapshotDirty) {
+        publishSnapshot();
+    }
+}
+
+void UserWorker::finish() {
+    while (!m_incomingRequests.empty()) {
+        m_context.requestPool.release(m_incomingRequests.front());
+        m_incomingRequests.pop();
+    }
+
+    while (!m_startedPrompts.empty()) {
+        if (m_startedPrompts.front().started) {
+            dismissUI(std::move(m_startedPrompts.front().ui));
+        }
+        m_startedPrompts.pop();
+    }
+
+    while (!m_requests.empty()) {
+        finishRequest(m_requests.begin());
+    }
+}
+
+void UserWorker::restorePrompt(PromptRecord record) {
+    RestoredPrompt restored;
+    restored.remaining = record.privileges;
+    restored.record = std::move(record);
+    restored.attached = false;
+    restored.owner = 0;
+    restored.answered = false;
+    restored.answer = URT_ERROR;
+    {
+        std::lock_guard<std::mutex> lock(m_snapshotMutex);
+        m_snapshot.push_back(restored.record);
+    }
+    m_restoredPrompts.push_back(std::move(restored));
+}
+
+void UserWorker::snapshotPrompts(std::vector<PromptRecord> &prompts) {
+    std::lock_guard<std::mutex> lock(m_snapshotMutex);
+    prompts.insert(prompts.end(), m_snapshot.begin(), m_snapshot.end());
+}
+
+void UserWorker::pushRequest(Request *request) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_incomingRequests.push(request);
+    m_event.notify_one();
+}
+
+void UserWorker::run() {
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+
+    ALOGD("Worker [" << m_index << "] started");
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping) {
+        m_event.wait_for(lock, timeToNextEvent());
+
+        if (m_stopping) {
+            break;
+        }
+
+        lock.unlock();
+        m_watchdog.enter(LoopPhase::Maintenance);
+        startPendingUIs();
+        expireRequests();
+        if (m_snapshotDirty) {
+            publishSnapshot();
+        }
+        cleanupUIThreads();
+        m_watchdog.iterationDone();
+        lock.lock();
+
+        while (!m_stopping && (!m_incomingRequests.empty() || !m_incomingResponses.empty()
+                               || !m_startedPrompts.empty())) {
+
+            if (!m_startedPrompts.empty()) {
+                PromptJob job = std::move(m_startedPrompts.front());
+                m_startedPrompts.pop();
+                lock.unlock();
+
+                m_watchdog.enter(LoopPhase::Prompts);
+                processStartedPrompt(job);
+                recyclePromptJob(std::move(job));
+
+                lock.lock();
+            }
+
+            if (!m_incomingRequests.empty()) {
+                Request *request = m_incomingRequests.front();
+                m_incomingRequests.pop();
+                lock.unlock();
+
+                m_watchdog.enter(LoopPhase::Requests);
+                processRequest(request);
+
+                lock.lock();
+            }
+
+            if (!m_incomingResponses.empty()) {
+                Response response = m_incomingResponses.front();
+                m_incomingResponses.pop();
+                lock.unlock();
+
+                m_watchdog.enter(LoopPhase::Responses);
+                ALOGD("Response popped from queue:"
+                     " type [" << response.type() << "],"
+                     " id [" << response.id() << "]");
+
+                dispatch(response.id(), RequestEvent::Answered, response.type(),
+                         response.prompt());
+
+                lock.lock();
+            }
+
+            lock.unlock();
+            m_watchdog.enter(LoopPhase::UICleanup);
+            cleanupUIThreads();
+            m_watchdog.iterationDone();
+            lock.lock();
+        }
+    }
+
+    ALOGD("Worker [" << m_index << "] stopped");
+}
+
+// Request was decoded and checked against rules by agent
+void UserWorker::processRequest(Request *request) {
+    PooledRequestPtr requestPtr(request, RequestReleaser{&m_context.requestPool});
+    Trace::Timestamp popped = Trace::now();
+
+    if (request->type() == RT_Cancel) {
+        dispatch(request->id(), RequestEvent::Cancelled);
+        return;
+    }
+
+    if (m_requests.count(request->id())) {
+        ALOGE("Incoming request with ID: [" << request->id() << "] is being already processed");
+        return;
+    }
+
+    const RequestData &data = request->requestData();
+    Trace::recordSpan(m_context.spans, "agent.queue", data.correlationId, request->received(),
+                      popped);
+
+    ActiveRequest active;
+    active.state = RequestState::Queued;
+    active.prompt = 0;
+    active.deadline = std::chrono::steady_clock::time_point::max();
+    active.correlationId = data.correlationId;
+    active.received = request->received();
+    active.since = popped;
+    // Identifiers are interned only to be audited, so the table does not grow otherwise
+    if (m_context.audit.isOpen()) {
+        active.client = Intern::intern(data.client);
+        active.user = Intern::intern(data.user);
+        active.privilege = Intern::intern(data.privilege);
+    } else {
+        active.client = active.user = active.privilege = 0;
+    }
+    m_requests.insert(std::make_pair(request->id(), std::move(active)));
+
+    if (reattachUI(request->id(), data)) {
+        return;
+    }
+
+    queueForUI(request->id(), data);
+}
+
+void UserWorker::dispatch(RequestId requestId, RequestEvent event, UIResponseType responseType,
+                     PromptSerial prompt) {
+    auto it = m_requests.find(requestId);
+    if (it != m_requests.end() && prompt && it->second.prompt != prompt) {
+        // Answer of prompt of finished request, whose ID was given to a new one
+        ALOGD("Answer of stale prompt for request [" << requestId << "] dropped");
+        return;
+    }
+    if (it == m_requests.end()) {
+        if (event == RequestEvent::Cancelled) {
+            ALOGE("Cancel request for unknown request: ID: [" << requestId << "]");
+        } else if (event == RequestEvent::Answered) {
+            // Restored prompt keeps waiting requests even when request attached to it is gone
+            answerRestored(requestId, responseType);
+        }
+        return;
+    }
+
+    traceRequest(stateSpan(it->second.state), it->second);
+    switch (event) {
+    case RequestEvent::Cancelled:
+        m_context.cynaraTalker.sendResponse(RT_Cancel, requestId);
+        traceRequest("agent.cancel", it->second);
+        if (it->second.state == RequestState::Queued) {
+            cancelPendingPrompt(requestId);
+        }
+        finishRequest(it);
+        return;
+    case RequestEvent::DeadlineHit:
+        ALOGW("Request [" << requestId << "] was not answered before its deadline");
+        responseType = URT_TIMEOUT;
+        break;
+    case RequestEvent::Answered:
+        break;
+    }
+
+    sendAnswer(requestId, responseType);
+    traceRequest("agent.respond", it->second);
+    auditAnswer(it->second, responseType);
+    finishRequest(it);
+    answerRestored(requestId, responseType);
+}
+
+void UserWorker::awaitAnswer(RequestId requestId, AskUIInterfacePtr ui, PromptSerial prompt,
+                        std::chrono::system_clock::time_point expiry) {
+    auto it = m_requests.find(requestId);
+    if (it == m_requests.end()) {
+        return;
+    }
+
+    auto now = std::chrono::system_clock::now();
+    auto left = expiry > now ? expiry - now : std::chrono::system_clock::duration::zero();
+    it->second.state = RequestState::Prompted;
+    it->second.ui = std::move(ui);
+    it->second.prompt = prompt;
+    it->second.deadline = std::chrono::steady_clock::now()
+                        + std::chrono::duration_cast<std::chrono::steady_clock::duration>(left)
+                        + deadlineGrace;
+    m_deadlines.insert(std::make_pair(it->second.deadline, requestId));
+}
+
+void UserWorker::expireRequests() {
+    auto now = std::chrono::steady_clock::now();
+    while (!m_deadlines.empty() && m_deadlines.begin()->first <= now) {
+        RequestId requestId = m_deadlines.begin()->second;
+        m_deadlines.erase(m_deadlines.begin());
+        dispatch(requestId, RequestEvent::DeadlineHit);
+    }
+}
+
+void UserWorker::sendAnswer(RequestId requestId, UIResponseType responseType) {
+    if (responseType == URT_ERROR) {
+        Translator::Agent::answerToData(Cynara::PolicyType(), AgentErrorMsg::Error, m_answer);
+    } else if (responseType == URT_TIMEOUT) {
+        Translator::Agent::answerToData(Cynara::PolicyType(), AgentErrorMsg::Timeout, m_answer);
+    } else {
+        Translator::Agent::answerToData(UIResponseToPolicyType(responseType),
+                                        AgentErrorMsg::NoError, m_answer);
+    }
+    m_context.requestAnswered(requestId);
+    m_context.cynaraTalker.sendResponse(RT_Action, requestId, m_answer);
+}
+
+// Timeouts and errors are audited as denial, as that is what client gets
+void UserWorker::auditAnswer(const ActiveRequest &request, UIResponseType responseType) {
+    Audit::Outcome outcome = Audit::Outcome::User;
+    Cynara::PolicyType answer = Cynara::PredefinedPolicyType::DENY;
+    if (responseType == URT_TIMEOUT) {
+        outcome = Audit::Outcome::Timeout;
+    } else if (responseType == URT_ERROR) {
+        outcome = Audit::Outcome::Error;
+    } else {
+        answer = UIResponseToPolicyType(responseType);
+    }
+    m_context.audit.record(request.client, request.user, request.privilege, answer, outcome,
+                   request.received);
+}
+
+void UserWorker::finishRequest(ActiveRequests::iterator it) {
+    AskUIInterfacePtr ui = std::move(it->second.ui);
+    m_deadlines.erase(std::make_pair(it->second.deadline, it->first));
+    m_requests.erase(it);
+
+    // Prompt shared with other requests stays until the last of them is done
+    if (!ui || ui.use_count() > 1) {
+        return;
+    }
+    if (m_shownPrompts.erase(ui->id())) {
+        m_snapshotDirty = true;
+    }
+    dismissUI(std::move(ui));
+}
+
+void UserWorker::dismissUI(AskUIInterfacePtr ui) {
+    if (!ui->dismiss()) {
+        m_finishedUIs.push_back(std::move(ui));
+    }
+}
+
+void UserWorker::queueForUI(RequestId requestId, const RequestData &data) {
+    if (m_context.batchWindow == std::chrono::milliseconds::zero()) {
+        PromptJob job = takePromptJob(data.client, data.user);
+        std::size_t count = 0;
+        addPrivilege(job, count, requestId, data.privilege);
+        job.privileges.resize(count);
+        startUIForRequests(std::move(job));
+        return;
+    }
+
+    auto it = std::find_if(m_pendingPrompts.begin(), m_pendingPrompts.end(),
+                           [&data](const PendingPrompt &prompt) {
+                               return prompt.job.client == data.client
+                                      && prompt.job.user == data.user;
+                           });
+    if (it == m_pendingPrompts.end()) {
+        PendingPrompt prompt;
+        prompt.deadline = std::chrono::steady_clock::now() + m_context.batchWindow;
+        prompt.job = takePromptJob(data.client, data.user);
+        prompt.privileges = 0;
+        m_pendingPrompts.push_back(std::move(prompt));
+        it = m_pendingPrompts.end() - 1;
+    }
+    addPrivilege(it->job, it->privileges, requestId, data.privilege);
+}
+
+void UserWorker::startPendingUIs() {
+    auto now = std::chrono::steady_clock::now();
+    for (auto it = m_pendingPrompts.begin(); it != m_pendingPrompts.end();) {
+        if (it->deadline > now) {
+            ++it;
+            continue;
+        }
+
+        ALOGD("Starting prompt for [" << it->privileges << "] requests of"
+              " client: <" << it->job.client << ">, user: <" << it->job.user << ">");
+        it->job.privileges.resize(it->privileges);
+        startUIForRequests(std::move(it->job));
+        it = m_pendingPrompts.erase(it);
+    }
+}
+
+void UserWorker::cancelPendingPrompt(RequestId requestId) {
+    for (auto it = m_pendingPrompts.begin(); it != m_pendingPrompts.end(); ++it) {
+        auto &privileges = it->job.privileges;
+        auto end = privileges.begin() + it->privileges;
+        for (auto privIt = privileges.begin(); privIt != end; ++privIt) {
+            if (privIt->first == requestId) {
+                // Moved behind batched ones, so its string is reused
+                std::rotate(privIt, privIt + 1, end);
+                if (!--it->privileges) {
+                    recyclePromptJob(std::move(it->job));
+                    m_pendingPrompts.erase(it);
+                }
+                return;
+            }
+        }
+    }
+}
+
+std::chrono::milliseconds UserWorker::timeToNextEvent() const {
+    auto timeout = maxWaitTime;
+    if (!m_finishedUIs.empty()) {
+        timeout = uiCleanupInterval;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (!m_deadlines.empty()) {
+        if (m_deadlines.begin()->first <= now) {
+            return std::chrono::milliseconds::zero();
+        }
+        timeout = std::min(timeout, std::chrono::duration_cast<std::chrono::milliseconds>(
+                                        m_deadlines.begin()->first - now)
+                                    + std::chrono::milliseconds(1));
+    }
+    for (const auto &prompt : m_pendingPrompts) {
+        if (prompt.deadline <= now) {
+            return std::chrono::milliseconds::zero();
+        }
+        // Round up, so we do not wake up just before deadline
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        prompt.deadline - now) + std::chrono::milliseconds(1);
+        timeout = std::min(timeout, left);
+    }
+    return timeout;
+}
+
+PromptJob UserWorker::takePromptJob(const std::string &client, const std::string &user) {
+    PromptJob job;
+    if (!m_spareJobs.empty()) {
+        job = std::move(m_spareJobs.back());
+        m_spareJobs.pop_back();
+    } else {
+        job.client.reserve(RequestPool::FIELD_RESERVE);
+        job.user.reserve(RequestPool::FIELD_RESERVE);
+    }
+    job.client.assign(client);
+    job.user.assign(user);
+    return job;
+}
+
+// Privileges beyond count are left from previous prompt, their strings are reused
+void UserWorker::addPrivilege(PromptJob &job, std::size_t &count, RequestId requestId,
+                              const std::string &privilege) {
+    if (count == job.privileges.size()) {
+        job.privileges.push_back(PrivilegeRequest());
+        job.privileges.back().second.reserve(RequestPool::FIELD_RESERVE);
+    }
+    job.privileges[count].first = requestId;
+    job.privileges[count].second.assign(privilege);
+    ++count;
+}
+
+void UserWorker::recyclePromptJob(PromptJob job) {
+    if (m_spareJobs.size() == spareJobs) {
+        return;
+    }
+    job.ui.reset();
+    job.responseCallback = nullptr;
+    m_spareJobs.push_back(std::move(job));
+}
+
+void UserWorker::startUIForRequests(PromptJob job) {
+    // UI dependencies are not guaranteed to be safe for concurrent initialization
+    m_context.waitForWarmup();
+
+    PromptSerial prompt = ++m_lastPrompt;
+    for (const auto &privilege : job.privileges) {
+        auto it = m_requests.find(privilege.first);
+        if (it != m_requests.end()) {
+            traceRequest(stateSpan(it->second.state), it->second);
+            it->second.state = RequestState::Starting;
+            it->second.prompt = prompt;
+        }
+    }
+
+    job.ui = m_context.uiFactory.create();
+    job.prompt = prompt;
+    job.responseCallback = [this, prompt](RequestId requestId, UIResponseType resultType) {
+                               UIResponseHandler(prompt, requestId, resultType);
+                           };
+    job.started = false;
+    job.sink = this;
+    m_promptWorkers.submit(std::move(job));
+}
+
+void UserWorker::handlePrompt(PromptJob &job) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_startedPrompts.push(std::move(job));
+    m_event.notify_one();
+}
+
+/*
+ * Requests could be cancelled or even answered while their prompt was being created.
+ * Prompt waits only for these which are still starting.
+ */
+void UserWorker::processStartedPrompt(PromptJob &job) {
+    if (!job.started) {
+        ALOGE("Prompt for client: <" << job.client << ">, user: <" << job.user << ">"
+              " could not be started");
+        for (const auto &privilege : job.privileges) {
+            dispatch(privilege.first, RequestEvent::Answered, URT_ERROR, job.prompt);
+        }
+        return;
+    }
+
+    PromptRecord record;
+    bool snapshot = m_context.promptSnapshots;
+    if (snapshot) {
+        record.uiId = job.ui->id();
+        record.client = job.client;
+        record.user = job.user;
+    }
+    record.expiry = job.ui->expiry();
+    bool waiting = false;
+    for (const auto &privilege : job.privileges) {
+        auto it = m_requests.find(privilege.first);
+        if (it == m_requests.end() || it->second.state != RequestState::Starting
+            || it->second.prompt != job.prompt) {
+            continue;
+        }
+        traceRequest(stateSpan(it->second.state), it->second);
+        awaitAnswer(privilege.first, job.ui, job.prompt, record.expiry);
+        waiting = true;
+        if (snapshot) {
+            record.privileges.push_back(privilege.second);
+        }
+    }
+
+    if (!waiting) {
+        dismissUI(std::move(job.ui));
+        return;
+    }
+    if (snapshot) {
+        m_shownPrompts[record.uiId] = std::move(record);
+        m_snapshotDirty = true;
+    }
+}
+
+void UserWorker::UIResponseHandler(PromptSerial prompt, RequestId requestId,
+                              UIResponseType responseType) {
+    ALOGD("UI response received: type [" << responseType << "], id [" << requestId << "]");
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_incomingResponses.push(Response(prompt, requestId, responseType));
+    m_event.notify_one();
+}
+
+void UserWorker::traceRequest(const char *span, ActiveRequest &request) {
+    Trace::Timestamp now = Trace::now();
+    Trace::recordSpan(m_context.spans, span, request.correlationId, request.since, now);
+    request.since = now;
+}
+
+const char *UserWorker::stateSpan(RequestState state) {
+    switch (state) {
+    case RequestState::Queued:
+        return "agent.batch";
+    case RequestState::Starting:
+        return "agent.prompt";
+    case RequestState::Prompted:
+        return "agent.user";
+    }
+    return "agent.unknown";
+}
+
+bool UserWorker::cleanupUIThreads() {
+    for (auto it = m_finishedUIs.begin(); it != m_finishedUIs.end();) {
+        if ((*it)->dismiss()) {
+            it = m_finishedUIs.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return m_finishedUIs.empty();
+}
+
+void UserWorker::publishSnapshot() {
+    auto now = std::chrono::system_clock::now();
+    std::vector<PromptRecord> prompts;
+    for (const auto &prompt : m_shownPrompts) {
+        if (prompt.second.expiry > now) {
+            prompts.push_back(prompt.second);
+        }
+    }
+    for (auto it = m_restoredPrompts.begin(); it != m_restoredPrompts.end();) {
+        // Attached prompt is removed when its answer or timeout arrives
+        if (it->record.expiry <= now && (!it->attached || it->answered)) {
+            it = m_restoredPrompts.erase(it);
+            continue;
+        }
+        if (!it->answered) {
+            prompts.push_back(it->record);
+        }
+        ++it;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_snapshotMutex);
+        m_snapshot.swap(prompts);
+    }
+    m_snapshotDirty = false;
+    m_context.snapshotChanged();
+}
+
+/*
+ * Cynara sends requests again after agent restarts, each under a new ID. Request matching
+ * a prompt which is still shown waits for answer to that prompt instead of showing a new one.
+ * Only one request attaches to the notification, others of the same prompt wait for its answer.
+ */
+bool UserWorker::reattachUI(RequestId requestId, const RequestData &data) {
+    auto now = std::chrono::system_clock::now();
+    for (auto &restored : m_restoredPrompts) {
+        auto &record = restored.record;
+        if (record.expiry <= now || record.client != data.client || record.user != data.user) {
+            continue;
+        }
+        auto &remaining = restored.remaining;
+        auto privIt = std::find(remaining.begin(), remaining.end(), data.privilege);
+        if (privIt == remaining.end()) {
+            continue;
+        }
+
+        if (restored.answered) {
+            ALOGD("Request [" << requestId << "] answered by restored prompt ["
+                  << record.uiId << "]");
+            remaining.erase(privIt);
+            dispatch(requestId, RequestEvent::Answered, restored.answer);
+            return true;
+        }
+
+        if (restored.attached) {
+            awaitAnswer(requestId, nullptr, 0, record.expiry);
+            restored.waiting.push_back(requestId);
+            remaining.erase(privIt);
+            return true;
+        }
+
+        AskUIInterfacePtr ui = m_context.uiFactory.create();
+        PromptSerial prompt = ++m_lastPrompt;
+        auto handler = [this, prompt](RequestId requestId, UIResponseType resultType) {
+                           UIResponseHandler(prompt, requestId, resultType);
+                       };
+        if (!ui->attach(record.uiId, requestId, record.expiry, handler)) {
+            return false;
+        }
+        ALOGD("Request [" << requestId << "] reattached to prompt [" << record.uiId << "]");
+        awaitAnswer(requestId, ui, prompt, record.expiry);
+        restored.attached = true;
+        restored.owner = requestId;
+        remaining.erase(privIt);
+        m_snapshotDirty = true;
+        return true;
+    }
+    return false;
+}
+
+void UserWorker::answerRestored(RequestId owner, UIResponseType responseType) {
+    for (auto it = m_restoredPrompts.begin(); it != m_restoredPrompts.end(); ++it) {
+        if (!it->attached || it->answered || it->owner != owner) {
+            continue;
+        }
+
+        it->answered = true;
+        it->answer = responseType;
+        std::vector<RequestId> waiting;
+        waiting.swap(it->waiting);
+        // Requests arriving later get the same answer, unless user did not give any
+        if (it->remaining.empty() || responseType == URT_TIMEOUT || responseType == URT_ERROR) {
+            m_restoredPrompts.erase(it);
+        }
+        m_snapshotDirty = true;
+
+        for (auto requestId : waiting) {
+            dispatch(requestId, RequestEvent::Answered, responseType);
+        }
+        return;
+    }
+}
+
+Cynara::PolicyType UserWorker::UIResponseToPolicyType(UIResponseType responseType) {
+    switch (responseType) {
+        case URT_YES_ONCE:
+            return AskUser::SupportedTypes::Client::ALLOW_ONCE;
+        case URT_YES_SESSION:
+            return AskUser::SupportedTypes::Client::ALLOW_PER_SESSION;
+        case URT_YES_LIFE:
+            return AskUser::SupportedTypes::Client::ALLOW_PER_LIFE;
+        case URT_NO_ONCE:
+            return AskUser::SupportedTypes::Client::DENY_ONCE;
+        case URT_NO_SESSION:
+            return AskUser::SupportedTypes::Client::DENY_PER_SESSION;
+        case URT_NO_LIFE:
+            return AskUser::SupportedTypes::Client::DENY_PER_LIFE;
+        default:
+            return AskUser::SupportedTypes::Client::DENY_ONCE;
+    }
+}
+
+} // namespace Agent
+
+} // namespace AskUser
@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+/**
+ * @file        UserWorker.h
+ * @author      Adam Malinowski <a.malinowsk2@partner.samsung.com>
+ * @brief       This file declares loop handling requests of users assigned to it
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <intern/InternTable.h>
+#include <trace/SpanRing.h>
+#include <types/PolicyType.h>
+#include <types/RequestData.h>
+
+#include <audit/AuditLog.h>
+#include <main/CynaraTalker.h>
+#include <main/LoopWatchdog.h>
+#include <main/NodePool.h>
+#include <main/PromptSnapshot.h>
+#include <main/PromptWorkers.h>
+#include <main/Request.h>
+#include <main/RequestPool.h>
+#include <main/Response.h>
+#include <main/RingQueue.h>
+
+#include <ui/AskUIInterface.h>
+
+namespace AskUser {
+
+namespace Agent {
+
+// Parts of agent shared by all workers, all of them are safe to use from any thread
+struct WorkerContext {
+    AskUIFactory &uiFactory;
+    CynaraTalker &cynaraTalker;
+    RequestPool &requestPool;
+    std::size_t promptWorkers; // threads creating prompts of every worker
+    AuditLog &audit;
+    Trace::SpanRing *spans;
+    std::chrono::milliseconds batchWindow;
+    bool promptSnapshots; // shown prompts are saved, so they survive restart of agent
+    std::function<void()> waitForWarmup;
+    std::function<void()> snapshotChanged;
+    // Called before request is answered, as cynara may give its ID to a new request afterwards
+    std::function<void(RequestId)> requestAnswered;
+};
+
+/*
+ * Every user is served by one worker, which owns its requests, prompts and their state.
+ * Requests come already decoded and not matched by rules. Every worker creates prompts in its
+ * own threads, so a user flooding agent with prompts or a prompt slow to start delays only
+ * users of the same worker.
+ */
+class UserWorker : private PromptSink {
+public:
+    static const std::size_t DEFAULT_COUNT = 4;
+
+    UserWorker(WorkerContext &context, std::size_t index);
+    ~UserWorker();
+
+    void start(std::chrono::milliseconds stallThreshold);
+    // Stops the loop, worker state is left for saveSnapshot() and finish()
+    void stop();
+    void finish();
+    bool cleanupUIThreads();
+
+    // Called before start(), for prompts shown to users of this worker
+    void restorePrompt(PromptRecord record);
+    // Prompts to be saved in snapshot, as of last change
+    void snapshotPrompts(std::vector<PromptRecord> &prompts);
+
+    void pushRequest(Request *request);
+
+    const LoopWatchdog &watchdog() const {
+        return m_watchdog;
+    }
+
+private:
+    WorkerContext &m_context;
+    std::size_t m_index;
+    RingQueue<Request *> m_incomingRequests;
+    RingQueue<Response> m_incomingResponses;
+    RingQueue<PromptJob> m_startedPrompts;
+    Cynara::PluginData m_answer;
+    std::condition_variable m_event;
+    std::mutex m_mutex;
+    bool m_stopping;
+    std::thread m_thread;
+    LoopWatchdog m_watchdog;
+    PromptWorkers m_promptWorkers;
+
+    /*
+     * Every request waiting for user is in one of states below. Whatever happens to it
+     * (answer of prompt, cancel from cynara, passing of deadline) goes through dispatch().
+     */
+    enum class RequestState {
+        Queued,   // waiting in batch for prompt to be shown
+        Starting, // prompt is being created by worker
+        Prompted  // waiting for answer of shown or restored prompt
+    };
+    enum class RequestEvent {
+        Answered,
+        Cancelled,
+        DeadlineHit
+    };
+    struct ActiveRequest {
+        RequestState state;
+        AskUIInterfacePtr ui; // shared by all requests of one prompt
+        PromptSerial prompt;  // 0 when answer comes from restored prompt of another request
+        std::chrono::steady_clock::time_point deadline;
+        Trace::CorrelationId correlationId;
+        Trace::Timestamp received;
+        Trace::Timestamp since; // start of current state, traced as span when it ends
+        Intern::Id client;
+        Intern::Id user;
+        Intern::Id privilege;
+    };
+    typedef std::pair<std::chrono::steady_clock::time_point, RequestId> Deadline;
+    typedef std::map<RequestId, ActiveRequest, std::less<RequestId>,
+                     NodeAllocator<std::pair<const RequestId, ActiveRequest>>> ActiveRequests;
+    // Nodes are reused, so requests waiting for user are tracked without allocating
+    NodePool m_requestNodes;
+    NodePool m_deadlineNodes;
+    ActiveRequests m_requests;
+    std::set<Deadline, std::less<Deadline>, NodeAllocator<Deadline>> m_deadlines;
+    // Prompts of finished requests, whose threads did not stop yet
+    std::vector<AskUIInterfacePtr> m_finishedUIs;
+    PromptSerial m_lastPrompt;
+
+    /*
+     * Requests of one client and user waiting to be shown in a single prompt. Prompt asks
+     * about every privilege separately, so each request gets answer for its own privilege.
+     * Job is filled while requests come, first privileges of job are the batched ones.
+     */
+    struct PendingPrompt {
+        std::chrono::steady_clock::time_point deadline;
+        PromptJob job;
+        std::size_t privileges;
+    };
+    std::vector<PendingPrompt> m_pendingPrompts;
+    // Jobs of started prompts are reused with memory of their strings
+    std::vector<PromptJob> m_spareJobs;
+
+    // Prompts shown to user by UI id, saved in snapshot to survive restart of agent
+    std::map<int, PromptRecord> m_shownPrompts;
+    // Prompts shown before restart, waiting for cynara to send their requests again
+    struct RestoredPrompt {
+        PromptRecord record;
+        std::vector<std::string> remaining; // privileges not requested again yet
+        bool attached;
+        RequestId owner;
+        std::vector<RequestId> waiting;
+        bool answered;
+        UIResponseType answer;
+    };
+    std::vector<RestoredPrompt> m_restoredPrompts;
+    bool m_snapshotDirty;
+    // Published by worker thread, taken by agent when it saves snapshot
+    std::mutex m_snapshotMutex;
+    std::vector<PromptRecord> m_snapshot;
+
+    void run();
+
+    void processRequest(Request *request);
+    void queueForUI(RequestId requestId, const RequestData &data);
+    void startPendingUIs();
+    void cancelPendingPrompt(RequestId requestId);
+    std::chrono::milliseconds timeToNextEvent() const;
+    PromptJob takePromptJob(const std::string &client, const std::string &user);
+    static void addPrivilege(PromptJob &job, std::size_t &count, RequestId requestId,
+                             const std::string &privilege);
+    void recyclePromptJob(PromptJob job);
+    void startUIForRequests(PromptJob job);
+    virtual void handlePrompt(PromptJob &job);
+    void processStartedPrompt(PromptJob &job);
+    void UIResponseHandler(PromptSerial prompt, RequestId requestId,
+                           UIResponseType responseType);
+
+    void dispatch(RequestId requestId, RequestEvent event,
+                  UIResponseType responseType = URT_ERROR, PromptSerial prompt = 0);
+    void awaitAnswer(RequestId requestId, AskUIInterfacePtr ui, PromptSerial prompt,
+                     std::chrono::system_clock::time_point expiry);
+    void expireRequests();
+    void sendAnswer(RequestId requestId, UIResponseType responseType);
+    void auditAnswer(const ActiveRequest &request, UIResponseType responseType);
+    void finishRequest(ActiveRequests::iterator it);
+    void dismissUI(AskUIInterfacePtr ui);
+
+    void traceRequest(const char *span, ActiveRequest &request);
+    static const char *stateSpan(RequestState state);
+
+    void publishSnapshot();
+    bool reattachUI(RequestId requestId, const RequestData &data);
+    void answerRestored(RequestId owner, UIResponseType responseType);
+
+    static Cynara::PolicyType UIResponseToPolicyType(UIResponseType responseType);
+};
+
+} // namespace Agent
+
+} // namespace AskUser
@@ -31,6 +31,9 @@
 
 #include <log/alog.h>
 
+#include <main/PhaseTimer.h>
+#include <ui/AskUINotificationBackend.h>
+
 #include "Agent.h"
 
 // Handle kill message from systemd
@@ -57,7 +60,13 @@ int main(int argc UNUSED, char **argv UNUSED) {
     ALOGD("Current locale is: <" << locale << ">");
 
     try {
-        AskUser::Agent::Agent agent;
+        AskUser::Agent::PhaseTimer startupTimer("startup");
+        AskUser::Agent::AskUINotificationFactory uiFactory;
+        AskUser::Agent::Agent agent(uiFactory);
+        if (!agent.start()) {
+            return EXIT_FAILURE;
+        }
+        startupTimer.stop();
 
         int ret = sd_notify(0, "READY=1");
         if (ret == 0) {
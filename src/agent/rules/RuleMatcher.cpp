@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+/**
+ * @file        RuleMatcher.cpp
+ * @author      Adam Malinowski <a.malinowsk2@partner.samsung.com>
+ * @brief       This file implements matcher of automatic decision rules
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fnmatch.h>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+
+#include <types/SupportedTypes.h>
+
+#include <log/alog.h>
+
+#include "RuleMatcher.h"
+
+namespace {
+
+const char *const globChars = "*?[";
+
+}
+
+namespace AskUser {
+
+namespace Agent {
+
+RuleMatcher::RuleMatcher(const std::string &path) : m_path(path) {
+    m_mtime.tv_sec = 0;
+    m_mtime.tv_nsec = 0;
+    compile();
+    reloadIfChanged();
+}
+
+bool RuleMatcher::reloadIfChanged() {
+    struct stat st;
+    if (stat(m_path.c_str(), &st) < 0) {
+        if (!m_rules.empty()) {
+            int erryes = errno;
+            ALOGW("Rules file <" << m_path << "> not available: <" << strerror(erryes) << ">."
+                  " Dropping " << m_rules.size() << " rules");
+            logHitCounters();
+            m_rules.clear();
+            compile();
+        }
+        m_mtime.tv_sec = 0;
+        m_mtime.tv_nsec = 0;
+        return false;
+    }
+
+    if (st.st_mtim.tv_sec == m_mtime.tv_sec && st.st_mtim.tv_nsec == m_mtime.tv_nsec) {
+        return false;
+    }
+
+    m_mtime = st.st_mtim;
+    return load();
+}
+
+bool RuleMatcher::load() {
+    std::vector<Rule> rules;
+    if (!parse(rules)) {
+        ALOGE("Rules file <" << m_path << "> is malformed. Keeping " << m_rules.size()
+              << " previously loaded rules");
+        return false;
+    }
+
+    logHitCounters();
+    m_rules.swap(rules);
+    compile();
+
+    ALOGI("Loaded " << m_rules.size() << " rules from <" << m_path << ">");
+    return true;
+}
+
+bool RuleMatcher::parse(std::vector<Rule> &rules) const {
+    std::ifstream file(m_path);
+    if (!file.is_open()) {
+        ALOGE("Unable to open rules file <" << m_path << ">");
+        return false;
+    }
+
+    std::string line;
+    unsigned lineNo = 0;
+    while (std::getline(file, line)) {
+        ++lineNo;
+        std::istringstream stream(line);
+        std::string action;
+        if (!(stream >> action) || action[0] == '#') {
+            continue;
+        }
+
+        Rule rule;
+        rule.hits = 0;
+        if (action == "allow") {
+            rule.decision = SupportedTypes::Client::ALLOW_ONCE;
+        } else if (action == "deny") {
+            rule.decision = SupportedTypes::Client::DENY_ONCE;
+        } else {
+            ALOGE("Unknown action <" << action << "> in line " << lineNo);
+            return false;
+        }
+
+        std::string trailing;
+        if (!(stream >> rule.client >> rule.user >> rule.privilege) || (stream >> trailing)) {
+            ALOGE("Wrong number of fields in line " << lineNo);
+            return false;
+        }
+
+        rules.push_back(std::move(rule));
+    }
+
+    return true;
+}
+
+void RuleMatcher::compile() {
+    m_trie.assign(1, Node());
+
+    for (std::size_t ruleIdx = 0; ruleIdx < m_rules.size(); ++ruleIdx) {
+        const std::string &pattern = m_rules[ruleIdx].privilege;
+        std::size_t prefixLen = std::min(pattern.find_first_of(globChars), pattern.size());
+
+        std::size_t node = 0;
+        for (std::size_t i = 0; i < prefixLen; ++i) {
+            std::size_t next = child(node, pattern[i]);
+            if (!next) {
+                next = m_trie.size();
+                m_trie.push_back(Node());
+                auto &children = m_trie[node].children;
+                auto it = std::lower_bound(children.begin(), children.end(),
+                                           std::make_pair(pattern[i], std::size_t(0)));
+                children.insert(it, std::make_pair(pattern[i], next));
+            }
+            node = next;
+        }
+        m_trie[node].rules.push_back(ruleIdx);
+    }
+}
+
+std::size_t RuleMatcher::child(std::size_t node, char c) const {
+    const auto &children = m_trie[node].children;
+    auto it = std::lower_bound(children.begin(), children.end(), std::make_pair(c, std::size_t(0)));
+    if (it != children.end() && it->first == c) {
+        return it->second;
+    }
+    return 0;
+}
+
+bool RuleMatcher::matches(const Rule &rule, const RequestData &data) const {
+    return !fnmatch(rule.privilege.c_str(), data.privilege.c_str(), 0)
+        && !fnmatch(rule.client.c_str(), data.client.c_str(), 0)
+        && !fnmatch(rule.user.c_str(), data.user.c_str(), 0);
+}
+
+bool RuleMatcher::match(const RequestData &data, Cynara::PolicyType &decision) {
+    if (m_rules.empty()) {
+        return false;
+    }
+
+    // Walk the trie along privilege and pick matching rule which comes first in the file
+    std::size_t best = m_rules.size();
+    std::size_t node = 0;
+    std::size_t pos = 0;
+    while (true) {
+        for (auto ruleIdx : m_trie[node].rules) {
+            if (ruleIdx < best && matches(m_rules[ruleIdx], data)) {
+                best = ruleIdx;
+            }
+        }
+        if (pos == data.privilege.size()) {
+            break;
+        }
+        node = child(node, data.privilege[pos++]);
+        if (!node) {
+            break;
+        }
+    }
+
+    if (best == m_rules.size()) {
+        return false;
+    }
+
+    Rule &rule = m_rules[best];
+    ++rule.hits;
+    decision = rule.decision;
+    ALOGD("Request client: <" << data.client << ">, user: <" << data.user << ">,"
+          " privilege: <" << data.privilege << "> decided by rule [" << best << "]");
+    return true;
+}
+
+void RuleMatcher::logHitCounters() const {
+    for (std::size_t i = 0; i < m_rules.size(); ++i) {
+        const Rule &rule = m_rules[i];
+        ALOGI("Rule [" << i << "] <" << rule.client << " " << rule.user << " " << rule.privilege
+              << "> hits: [" << rule.hits << "]");
+    }
+}
+
+} // namespace Agent
+
+} // namespace AskUser
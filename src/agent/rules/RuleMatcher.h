@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+/**
+ * @file        RuleMatcher.h
+ * @author      Adam Malinowski <a.malinowsk2@partner.samsung.com>
+ * @brief       This file declares matcher of automatic decision rules
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <types/PolicyType.h>
+#include <types/RequestData.h>
+
+namespace AskUser {
+
+namespace Agent {
+
+/*
+ * Rules file contains one rule per line:
+ *     <allow|deny> <client pattern> <user pattern> <privilege pattern>
+ * Patterns are shell globs (see fnmatch(3)). Empty lines and lines starting with '#' are ignored.
+ * First matching rule (in file order) decides.
+ */
+class RuleMatcher {
+public:
+    RuleMatcher(const std::string &path);
+
+    bool reloadIfChanged();
+    bool match(const RequestData &data, Cynara::PolicyType &decision);
+    void logHitCounters() const;
+
+private:
+    struct Rule {
+        Cynara::PolicyType decision;
+        std::string client;
+        std::string user;
+        std::string privilege;
+        std::uint64_t hits;
+    };
+
+    // Trie over literal prefixes of privilege patterns. Node 0 is the root.
+    struct Node {
+        std::vector<std::pair<char, std::size_t>> children; // sorted by character
+        std::vector<std::size_t> rules;                      // rules with prefix ending here
+    };
+
+    std::string m_path;
+    struct timespec m_mtime;
+    std::vector<Rule> m_rules;
+    std::vector<Node> m_trie;
+
+    bool load();
+    bool parse(std::vector<Rule> &rules) const;
+    void compile();
+    std::size_t child(std::size_t node, char c) const;
+    bool matches(const Rule &rule, const RequestData &data) const;
+};
+
+} // namespace Agent
+
+} // namespace AskUser
@@ -21,9 +21,12 @@
 
 #pragma once
 
+#include <chrono>
 #include <functional>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <main/Request.h>
 
@@ -43,6 +46,7 @@ typedef enum {
 } UIResponseType;
 
 typedef std::function<void(RequestId, UIResponseType)> UIResponseCallback;
+typedef std::pair<RequestId, std::string> PrivilegeRequest;
 
 class AskUIInterface {
 public:
@@ -50,12 +54,32 @@ public:
 
     virtual bool start(const std::string &client, const std::string &user,
                        const std::string &privilege, RequestId requestId, UIResponseCallback) = 0;
+    // Single prompt for several privileges; every privilege is answered separately and its
+    // answer is delivered to every request for it
+    virtual bool start(const std::string &client, const std::string &user,
+                       const std::vector<PrivilegeRequest> &privileges, UIResponseCallback) = 0;
+    // Waits for answer to UI started by previous instance of agent
+    virtual bool attach(int id, RequestId requestId,
+                        std::chrono::system_clock::time_point expiry, UIResponseCallback) = 0;
+    // Identifier and expiry time of started UI, needed to attach to it later
+    virtual int id() const = 0;
+    virtual std::chrono::system_clock::time_point expiry() const = 0;
     virtual bool setOutdated() = 0;
     virtual bool dismiss() = 0;
     virtual bool isDismissing() const = 0;
 };
 
-typedef std::unique_ptr<AskUIInterface> AskUIInterfacePtr;
+typedef std::shared_ptr<AskUIInterface> AskUIInterfacePtr;
+
+// Creates UIs shown by agent, so agent can be run with UI other than notifications
+class AskUIFactory {
+public:
+    virtual ~AskUIFactory() {};
+
+    virtual AskUIInterfacePtr create() = 0;
+    // Loads dependencies of UI before first prompt needs them
+    virtual void warmUp() {};
+};
 
 } // namespace Agent
 
@@ -19,6 +19,7 @@
  * @brief       This file implements class for ask user window
  */
 
+#include <algorithm>
 #include <bundle.h>
 #include <cerrno>
 #include <csignal>
@@ -27,6 +28,7 @@
 #include <cstring>
 #include <libintl.h>
 #include <privilegemgr/privilege_info.h>
+#include <string>
 
 #include <attributes/attributes.h>
 
@@ -59,6 +61,20 @@ const char *errorToString(notification_error_e error) {
     return "UNHANDLED ERROR";
 }
 
+std::string displayName(const std::string &privilege) {
+    char *privilegeDisplayName;
+    int ret = privilege_info_get_privilege_display_name(privilege.c_str(), &privilegeDisplayName);
+    if (ret != PRVMGR_ERR_NONE) {
+        ALOGE("Unable to get privilege display name, err: [" << ret << "]");
+        return privilege;
+    }
+    ALOGD("privilege_info_get_privilege_display_name: [" << ret << "],"
+         " <" << privilegeDisplayName << ">");
+    std::string name(privilegeDisplayName);
+    free(privilegeDisplayName);
+    return name;
+}
+
 }
 
 namespace AskUser {
@@ -66,6 +82,7 @@ namespace AskUser {
 namespace Agent {
 
 AskUINotificationBackend::AskUINotificationBackend() : m_notification(nullptr),
+                                                       m_id(NOTIFICATION_PRIV_ID_NONE),
                                                        m_dismissing(false) {
     m_future = m_threadFinished.get_future();
 }
@@ -77,24 +94,108 @@ AskUINotificationBackend::~AskUINotificationBackend() {
 bool AskUINotificationBackend::start(const std::string &client, const std::string &user,
                                      const std::string &privilege, RequestId requestId,
                                      UIResponseCallback responseCallback) {
+    return start(client, user, {PrivilegeRequest(requestId, privilege)}, responseCallback);
+}
+
+bool AskUINotificationBackend::start(const std::string &client, const std::string &user,
+                                     const std::vector<PrivilegeRequest> &privileges,
+                                     UIResponseCallback responseCallback) {
     if (!responseCallback) {
         ALOGE("Empty response callback is not allowed");
         return false;
     }
 
-    if (!createUI(client, user, privilege)) {
+    if (privileges.empty()) {
+        ALOGE("No privileges to ask for");
+        return false;
+    }
+
+    m_client = client;
+    m_user = user;
+    for (const auto &request : privileges) {
+        auto page = std::find_if(m_pages.begin(), m_pages.end(),
+                                 [&request](const Page &candidate) {
+                                     return candidate.privilege == request.second;
+                                 });
+        if (page == m_pages.end()) {
+            m_pages.push_back(Page{request.second, displayName(request.second), {}});
+            page = m_pages.end() - 1;
+        }
+        page->requestIds.push_back(request.first);
+        m_requestIds.push_back(request.first);
+    }
+
+    if (!createUI(0, m_id)) {
         ALOGE("UI window for request could not be created!");
         return false;
     }
 
-    m_requestId = requestId;
+    m_expiry = std::chrono::system_clock::now() + std::chrono::seconds(m_responseTimeout);
+    m_responseCallback = responseCallback;
+    m_thread = std::thread(&AskUINotificationBackend::run, this);
+    return true;
+}
+
+bool AskUINotificationBackend::attach(int id, RequestId requestId,
+                                      std::chrono::system_clock::time_point expiry,
+                                      UIResponseCallback responseCallback) {
+    if (!responseCallback) {
+        ALOGE("Empty response callback is not allowed");
+        return false;
+    }
+
+    auto timeout = std::chrono::duration_cast<std::chrono::seconds>(
+                       expiry - std::chrono::system_clock::now()).count();
+    if (timeout <= 0) {
+        ALOGD("Notification [" << id << "] already expired");
+        return false;
+    }
+
+    m_notification = notification_load(const_cast<char *>("cynara-askuser"), id);
+    if (m_notification == nullptr) {
+        ALOGW("Unable to load notification [" << id << "]");
+        return false;
+    }
+
+    m_id = id;
+    m_expiry = expiry;
+    m_requestIds.push_back(requestId);
+    // Only the shown page is known, pages after it are asked by requests sent again
+    m_pages.push_back(Page{std::string(), std::string(), {requestId}});
     m_responseCallback = responseCallback;
     m_thread = std::thread(&AskUINotificationBackend::run, this);
     return true;
 }
 
-bool AskUINotificationBackend::createUI(const std::string &client, const std::string &user,
-                                        const std::string &privilege) {
+std::string AskUINotificationBackend::pageMessage(std::size_t page) {
+    char tmpBuffer[BUFSIZ];
+    int ret;
+    if (m_pages.size() == 1) {
+        char *messageFormat = dgettext(PROJECT_NAME, "SID_PRIVILEGE_REQUEST_DIALOG_MESSAGE");
+        ret = std::snprintf(tmpBuffer, sizeof(tmpBuffer), messageFormat, m_client.c_str(),
+                            m_user.c_str(), m_pages[page].displayName.c_str());
+    } else {
+        std::string displayNames;
+        for (const auto &other : m_pages) {
+            if (!displayNames.empty()) {
+                displayNames += "\n";
+            }
+            displayNames += other.displayName;
+        }
+        char *messageFormat = dgettext(PROJECT_NAME, "SID_PRIVILEGES_REQUEST_DIALOG_MESSAGE");
+        ret = std::snprintf(tmpBuffer, sizeof(tmpBuffer), messageFormat, m_client.c_str(),
+                            m_user.c_str(), displayNames.c_str(), static_cast<int>(page + 1),
+                            static_cast<int>(m_pages.size()), m_pages[page].displayName.c_str());
+    }
+    if (ret < 0) {
+        int erryes = errno;
+        ALOGE("sprintf failed with error: <" << strerror(erryes) << ">");
+        return std::string();
+    }
+    return tmpBuffer;
+}
+
+bool AskUINotificationBackend::createUI(std::size_t page, int &id) {
     notification_error_e err;
 
     m_notification = notification_new(NOTIFICATION_TYPE_NOTI, NOTIFICATION_GROUP_ID_NONE,
@@ -118,28 +219,15 @@ bool AskUINotificationBackend::createUI(const std::string &client, const std::st
         return false;
     }
 
-    char *messageFormat = dgettext(PROJECT_NAME, "SID_PRIVILEGE_REQUEST_DIALOG_MESSAGE");
-    char *privilegeDisplayName;
-    int ret = privilege_info_get_privilege_display_name(privilege.c_str(), &privilegeDisplayName);
-    if (ret != PRVMGR_ERR_NONE) {
-        ALOGE("Unable to get privilege display name, err: [" << ret << "]");
-        privilegeDisplayName = strdup(privilege.c_str());
-    }
-    ALOGD("privilege_info_get_privilege_display_name: [" << ret << "],"
-         " <" << privilegeDisplayName << ">");
-
-    char tmpBuffer[BUFSIZ];
-    ret = std::snprintf(tmpBuffer, sizeof(tmpBuffer), messageFormat, client.c_str(), user.c_str(),
-                   privilegeDisplayName);
-    free(privilegeDisplayName);
-    if (ret < 0) {
-        int erryes = errno;
-        ALOGE("sprintf failed with error: <" << strerror(erryes) << ">");
+    std::string message = pageMessage(page);
+    if (message.empty()) {
         return false;
     }
 
-    err = notification_set_text(m_notification, NOTIFICATION_TEXT_TYPE_CONTENT, tmpBuffer, nullptr,
-                                NOTIFICATION_VARIABLE_TYPE_NONE);
+    char tmpBuffer[BUFSIZ];
+    int ret;
+    err = notification_set_text(m_notification, NOTIFICATION_TEXT_TYPE_CONTENT, message.c_str(),
+                                nullptr, NOTIFICATION_VARIABLE_TYPE_NONE);
     if (err != NOTIFICATION_ERROR_NONE) {
         ALOGE("Unable to set notification content: <" << errorToString(err) << ">");
         return false;
@@ -182,7 +270,7 @@ bool AskUINotificationBackend::createUI(const std::string &client, const std::st
 
     bundle_free(b);
 
-    err = notification_insert(m_notification, nullptr);
+    err = notification_insert(m_notification, &id);
     if (err != NOTIFICATION_ERROR_NONE) {
         ALOGE("Unable to insert notification: <" << errorToString(err) << ">");
         return false;
@@ -191,6 +279,19 @@ bool AskUINotificationBackend::createUI(const std::string &client, const std::st
     return true;
 }
 
+void AskUINotificationBackend::warmUp() {
+    dgettext(PROJECT_NAME, "SID_PRIVILEGE_REQUEST_DIALOG_TITLE");
+
+    char *displayName = nullptr;
+    int ret = privilege_info_get_privilege_display_name("http://tizen.org/privilege/internet",
+                                                        &displayName);
+    if (ret == PRVMGR_ERR_NONE) {
+        free(displayName);
+    } else {
+        ALOGW("Privilege manager warmup failed, err: [" << ret << "]");
+    }
+}
+
 bool AskUINotificationBackend::setOutdated() {
     // There is no possibility to update window using notifications framework - at least for now
     return true;
@@ -202,12 +303,15 @@ bool AskUINotificationBackend::dismiss() {
     m_dismissing = true;
     auto status = m_future.wait_for(std::chrono::milliseconds(10));
     if (status == std::future_status::ready) {
-        ALOGD("UI thread, for request: [" << m_requestId << "], finished and ready to join.");
-        m_thread.join();
+        ALOGD("UI thread, for request: [" << m_requestIds.front() << "], finished and ready to"
+              " join.");
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
         return true;
     }
 
-    ALOGD("UI thread, for request: [" << m_requestId << "], not finished.");
+    ALOGD("UI thread, for request: [" << m_requestIds.front() << "], not finished.");
     return false;
 }
 
@@ -222,31 +326,37 @@ void AskUINotificationBackend::run() {
     }
 
     try {
-        int buttonClicked = 0;
-        notification_error_e ret = notification_wait_response(m_notification, m_responseTimeout,
-                                                              &buttonClicked, nullptr);
-        ALOGD("notification_wait_response finished with ret code: [" << ret << "]");
-
         UIResponseType response = URT_ERROR;
-        if (ret == NOTIFICATION_ERROR_NONE) {
-            if (buttonClicked) {
-                static UIResponseType respType[] = {URT_NO_ONCE, URT_NO_SESSION, URT_NO_LIFE,
-                                                    URT_YES_ONCE, URT_YES_SESSION, URT_YES_LIFE};
-                ALOGD("Got response from user: [" << buttonClicked << "]");
-                if (static_cast<unsigned int>(buttonClicked) >
-                                                        sizeof(respType) / sizeof(respType[0])) {
-                    ALOGE("Wrong code of response: [" << buttonClicked << "]");
-                } else {
-                    response = respType[buttonClicked - 1];
+        for (std::size_t page = 0; page < m_pages.size(); ++page) {
+            // Agent no longer waits for any request of prompt
+            if (page && m_dismissing) {
+                break;
+            }
+            // Prompt which was not answered or failed gives the same answer to the rest
+            if (page && (response == URT_TIMEOUT || response == URT_ERROR)) {
+                for (auto requestId : m_pages[page].requestIds) {
+                    m_responseCallback(requestId, response);
+                }
+                continue;
+            }
+            bool shown = true;
+            if (page) {
+                notification_free(m_notification);
+                m_notification = nullptr;
+                int id;
+                shown = createUI(page, id);
+                if (!shown) {
+                    ALOGE("UI window for privilege <" << m_pages[page].privilege << "> could"
+                          " not be created!");
                 }
-            } else {
-                ALOGD("notification_wait_response, for request ID: [" << m_requestId <<
-                     "] timeouted");
-                response = URT_TIMEOUT;
+            }
+
+            response = shown ? waitForResponse() : URT_ERROR;
+            for (auto requestId : m_pages[page].requestIds) {
+                m_responseCallback(requestId, response);
             }
         }
-        m_responseCallback(m_requestId, response);
-        ALOGD("UI thread for request ID: [" << m_requestId << "] stopped execution");
+        ALOGD("UI thread for request ID: [" << m_requestIds.front() << "] stopped execution");
     } catch (const std::exception &e) {
         ALOGE("Unexpected exception: <" << e.what() << ">");
     } catch (...) {
@@ -255,6 +365,37 @@ void AskUINotificationBackend::run() {
     m_threadFinished.set_value(true);
 }
 
+// Waits for answer to shown page, at most until the whole prompt expires
+UIResponseType AskUINotificationBackend::waitForResponse() {
+    auto timeout = std::chrono::duration_cast<std::chrono::seconds>(
+                       m_expiry - std::chrono::system_clock::now()).count();
+    if (timeout <= 0) {
+        return URT_TIMEOUT;
+    }
+
+    int buttonClicked = 0;
+    notification_error_e ret = notification_wait_response(m_notification, timeout,
+                                                          &buttonClicked, nullptr);
+    ALOGD("notification_wait_response finished with ret code: [" << ret << "]");
+    if (ret != NOTIFICATION_ERROR_NONE) {
+        return URT_ERROR;
+    }
+    if (!buttonClicked) {
+        ALOGD("notification_wait_response, for request ID: [" << m_requestIds.front() <<
+             "] timeouted");
+        return URT_TIMEOUT;
+    }
+
+    static UIResponseType respType[] = {URT_NO_ONCE, URT_NO_SESSION, URT_NO_LIFE,
+                                        URT_YES_ONCE, URT_YES_SESSION, URT_YES_LIFE};
+    ALOGD("Got response from user: [" << buttonClicked << "]");
+    if (static_cast<unsigned int>(buttonClicked) > sizeof(respType) / sizeof(respType[0])) {
+        ALOGE("Wrong code of response: [" << buttonClicked << "]");
+        return URT_ERROR;
+    }
+    return respType[buttonClicked - 1];
+}
+
 } // namespace Agent
 
 } // namespace AskUser
@@ -24,7 +24,9 @@
 #include <atomic>
 #include <notification.h>
 #include <future>
+#include <string>
 #include <thread>
+#include <vector>
 
 #include <ui/AskUIInterface.h>
 
@@ -40,24 +42,68 @@ public:
     virtual bool start(const std::string &client, const std::string &user,
                        const std::string &privilege, RequestId requestId,
                        UIResponseCallback responseCallback);
+    virtual bool start(const std::string &client, const std::string &user,
+                       const std::vector<PrivilegeRequest> &privileges,
+                       UIResponseCallback responseCallback);
+    virtual bool attach(int id, RequestId requestId,
+                        std::chrono::system_clock::time_point expiry,
+                        UIResponseCallback responseCallback);
+    virtual int id() const {
+        return m_id;
+    }
+    virtual std::chrono::system_clock::time_point expiry() const {
+        return m_expiry;
+    }
     virtual bool setOutdated();
     virtual bool dismiss();
     virtual bool isDismissing() const {
         return m_dismissing;
     }
 
+    // Loads translations and privilege database before first prompt needs them
+    static void warmUp();
+
 private:
+    /*
+     * Notification gives one answer, so prompt for several privileges shows them one after
+     * another, each asking about one privilege and listing all of them. Every privilege gets
+     * its own answer, which goes to all requests for it.
+     */
+    struct Page {
+        std::string privilege;
+        std::string displayName;
+        std::vector<RequestId> requestIds;
+    };
+
     notification_h m_notification;
+    int m_id; // of notification shown first
+    std::chrono::system_clock::time_point m_expiry;
     std::thread m_thread;
-    RequestId m_requestId;
+    std::vector<RequestId> m_requestIds;
+    std::string m_client;
+    std::string m_user;
+    std::vector<Page> m_pages;
     UIResponseCallback m_responseCallback;
-    static const int m_responseTimeout = 60; // seconds
+    static const int m_responseTimeout = 60; // seconds, for all pages together
     std::promise<bool> m_threadFinished;
     std::future<bool> m_future;
     std::atomic<bool> m_dismissing;
 
     void run();
-    bool createUI(const std::string &client, const std::string &user, const std::string &privilege);
+    UIResponseType waitForResponse();
+    bool createUI(std::size_t page, int &id);
+    std::string pageMessage(std::size_t page);
+};
+
+class AskUINotificationFactory : public AskUIFactory {
+public:
+    virtual AskUIInterfacePtr create() {
+        return AskUIInterfacePtr(new AskUINotificationBackend());
+    }
+
+    virtual void warmUp() {
+        AskUINotificationBackend::warmUp();
+    }
 };
 
 } // namespace Agent
@@ -0,0 +1,122 @@
+/*
+ *  Copyright (c) 2015 Samsung Electronics Co.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/**
+ * @file        AuditRecord.h
+ * @author      Zofia Abramowska <z.abramowska@samsung.com>
+ * @brief       Definition of binary audit log of decisions given by agent
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace AskUser {
+namespace Audit {
+
+/*
+ * Log file is a header followed by fixed size records, so it can be mapped and scanned as
+ * an array. Clients, users and privileges are stored as ids, which are resolved by dictionary
+ * side file "<log>.dict" holding lines "<id> <value>". Backslash and newline in value are
+ * escaped as "\\" and "\n". Ids are valid only within one log file, which keeps them
+ * when agent restarts and appends to it.
+ */
+struct FileHeader {
+    static const std::uint32_t MAGIC = 0x44554141; // "AAUD"
+    static const std::uint32_t VERSION = 1;
+
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t recordSize;
+    std::uint32_t reserved;
+};
+
+enum class Outcome : std::uint8_t {
+    Rule,    // decided by agent rules without asking
+    User,    // answered by user
+    Timeout, // user did not answer in time
+    Error    // prompt failed
+};
+
+struct Record {
+    std::uint64_t time;      // nanoseconds since epoch
+    std::uint32_t client;
+    std::uint32_t user;
+    std::uint32_t privilege;
+    std::uint32_t latency;   // milliseconds since request came from cynara
+    std::uint16_t answer;    // policy type sent to cynara
+    Outcome outcome;
+    std::uint8_t reserved[5];
+};
+
+static_assert(sizeof(FileHeader) == 16, "Layout of audit log header changed");
+static_assert(sizeof(Record) == 32, "Layout of audit log record changed");
+
+inline std::string dictionaryPath(const std::string &logPath) {
+    return logPath + ".dict";
+}
+
+inline std::string escapeValue(const std::string &value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        if (c == '\\')
+            escaped += "\\\\";
+        else if (c == '\n')
+            escaped += "\\n";
+        else
+            escaped += c;
+    }
+    return escaped;
+}
+
+// Returns false for unknown escape sequence, such line was not written by agent
+inline bool unescapeValue(const std::string &escaped, std::string &value) {
+    value.clear();
+    for (std::size_t i = 0; i < escaped.size(); ++i) {
+        if (escaped[i] != '\\') {
+            value += escaped[i];
+            continue;
+        }
+        if (++i == escaped.size())
+            return false;
+        if (escaped[i] == '\\')
+            value += '\\';
+        else if (escaped[i] == 'n')
+            value += '\n';
+        else
+            return false;
+    }
+    return true;
+}
+
+inline const char *outcomeName(Outcome outcome) {
+    switch (outcome) {
+    case Outcome::Rule:
+        return "rule";
+    case Outcome::User:
+        return "user";
+    case Outcome::Timeout:
+        return "timeout";
+    case Outcome::Error:
+        return "error";
+    }
+    return "unknown";
+}
+
+} // namespace Audit
+} // namespace AskUser
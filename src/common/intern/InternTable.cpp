@@ -0,0 +1,126 @@
+/*
+ *  Copyright (c) 2015 Samsung Electronics Co.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/**
+ * @file        InternTable.cpp
+ * @author      Zofia Abramowska <z.abramowska@samsung.com>
+ * @brief       Implementation of table mapping identifiers to compact ids
+ */
+
+#include "InternTable.h"
+
+namespace {
+
+// Seeded up front, so most frequent identifiers get small ids and are not allocated on demand
+const char *const knownPrivileges[] = {
+    "http://tizen.org/privilege/account.read",
+    "http://tizen.org/privilege/account.write",
+    "http://tizen.org/privilege/alarm.get",
+    "http://tizen.org/privilege/alarm.set",
+    "http://tizen.org/privilege/bluetooth",
+    "http://tizen.org/privilege/calendar.read",
+    "http://tizen.org/privilege/calendar.write",
+    "http://tizen.org/privilege/call",
+    "http://tizen.org/privilege/callhistory.read",
+    "http://tizen.org/privilege/callhistory.write",
+    "http://tizen.org/privilege/camera",
+    "http://tizen.org/privilege/contact.read",
+    "http://tizen.org/privilege/contact.write",
+    "http://tizen.org/privilege/content.write",
+    "http://tizen.org/privilege/externalstorage",
+    "http://tizen.org/privilege/healthinfo",
+    "http://tizen.org/privilege/internet",
+    "http://tizen.org/privilege/location",
+    "http://tizen.org/privilege/mediastorage",
+    "http://tizen.org/privilege/message.read",
+    "http://tizen.org/privilege/message.write",
+    "http://tizen.org/privilege/network.get",
+    "http://tizen.org/privilege/network.set",
+    "http://tizen.org/privilege/nfc",
+    "http://tizen.org/privilege/notification",
+    "http://tizen.org/privilege/recorder",
+    "http://tizen.org/privilege/telephony",
+    "http://tizen.org/privilege/wifidirect",
+};
+
+} // namespace
+
+namespace AskUser {
+namespace Intern {
+
+Id InternTable::intern(const std::string &value) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_ids.find(std::cref(value));
+    if (it != m_ids.end())
+        return it->second;
+
+    Id id = static_cast<Id>(m_values.size());
+    m_values.push_back(value);
+    m_ids.insert(std::make_pair(std::cref(m_values.back()), id));
+
+    static const std::size_t inlineCapacity = std::string().capacity();
+    std::size_t capacity = m_values.back().capacity();
+    m_bytes += sizeof(std::string) + sizeof(IdMap::value_type) + 2 * sizeof(void *)
+               + (capacity > inlineCapacity ? capacity + 1 : 0);
+    return id;
+}
+
+bool InternTable::find(const std::string &value, Id &id) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_ids.find(std::cref(value));
+    if (it == m_ids.end())
+        return false;
+    id = it->second;
+    return true;
+}
+
+void InternTable::find(const std::vector<const std::string *> &values,
+                       std::vector<Id> &ids) const {
+    ids.resize(values.size());
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        auto it = m_ids.find(std::cref(*values[i]));
+        ids[i] = it != m_ids.end() ? it->second : NO_ID;
+    }
+}
+
+const std::string &InternTable::value(Id id) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_values.at(id);
+}
+
+std::size_t InternTable::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_values.size();
+}
+
+std::size_t InternTable::bytes() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_bytes;
+}
+
+InternTable &table() {
+    static InternTable instance;
+    static bool seeded = [] {
+        for (auto privilege : knownPrivileges)
+            instance.intern(privilege);
+        return true;
+    }();
+    (void)seeded;
+    return instance;
+}
+
+} // namespace Intern
+} // namespace AskUser
@@ -0,0 +1,95 @@
+/*
+ *  Copyright (c) 2015 Samsung Electronics Co.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/**
+ * @file        InternTable.h
+ * @author      Zofia Abramowska <z.abramowska@samsung.com>
+ * @brief       Definition of table mapping identifiers to compact ids
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace AskUser {
+namespace Intern {
+
+typedef std::uint32_t Id;
+// Given by batch lookup to value which was never interned
+const Id NO_ID = std::numeric_limits<Id>::max();
+
+/*
+ * Stores single copy of every client, user and privilege identifier and gives it a 32-bit id.
+ * Ids are never released, as caches, audit log and partitions keep them without counting
+ * references, so the table grows with number of distinct identifiers seen. It is bounded by
+ * installed applications, users and privileges, but not under churn of them (e.g. repeated
+ * install of applications with new names). Owners of memory budgets count bytes() in them.
+ */
+class InternTable {
+public:
+    InternTable() : m_bytes(0) {}
+    InternTable(const InternTable &) = delete;
+    InternTable &operator=(const InternTable &) = delete;
+
+    Id intern(const std::string &value);
+    // Does not add value to table, returns false if it was never interned
+    bool find(const std::string &value, Id &id) const;
+    // Looks up all values under one lock, without adding any of them
+    void find(const std::vector<const std::string *> &values, std::vector<Id> &ids) const;
+    const std::string &value(Id id) const;
+    std::size_t size() const;
+    // Estimated like cache entries: values, their heap buffers and nodes of map
+    std::size_t bytes() const;
+
+private:
+    struct Hash {
+        std::size_t operator()(const std::string &value) const {
+            return std::hash<std::string>()(value);
+        }
+    };
+    struct Equal {
+        bool operator()(const std::string &lhs, const std::string &rhs) const {
+            return lhs == rhs;
+        }
+    };
+    // Map keys refer to strings owned by m_values, which never moves its elements
+    typedef std::unordered_map<std::reference_wrapper<const std::string>, Id, Hash, Equal> IdMap;
+
+    mutable std::mutex m_mutex;
+    std::deque<std::string> m_values;
+    IdMap m_ids;
+    std::size_t m_bytes;
+};
+
+// Process wide table pre-seeded with known privileges
+InternTable &table();
+
+inline Id intern(const std::string &value) {
+    return table().intern(value);
+}
+
+inline const std::string &value(Id id) {
+    return table().value(id);
+}
+
+} // namespace Intern
+} // namespace AskUser
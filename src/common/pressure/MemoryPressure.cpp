@@ -0,0 +1,97 @@
+/*
+ *  Copyright (c) 2015 Samsung Electronics Co.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/**
+ * @file        MemoryPressure.cpp
+ * @author      Zofia Abramowska <z.abramowska@samsung.com>
+ * @brief       Implementation of memory pressure monitor based on pressure stall information
+ */
+
+#include "MemoryPressure.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace AskUser {
+namespace Pressure {
+
+const char *const MemoryPressure::DEFAULT_PATH = "/proc/pressure/memory";
+constexpr double MemoryPressure::DEFAULT_ENTER_THRESHOLD;
+constexpr double MemoryPressure::DEFAULT_EXIT_THRESHOLD;
+
+MemoryPressure::MemoryPressure(const std::string &path, double enterThreshold,
+                               double exitThreshold, std::chrono::milliseconds interval)
+    : m_path(path),
+      m_enterThreshold(enterThreshold),
+      m_exitThreshold(exitThreshold),
+      m_interval(interval),
+      m_nextRead(std::chrono::steady_clock::now()),
+      m_available(true),
+      m_active(false)
+{}
+
+MemoryPressure::Transition MemoryPressure::poll() {
+    auto now = std::chrono::steady_clock::now();
+    if (!m_available || now < m_nextRead)
+        return Transition::None;
+    m_nextRead = now + m_interval;
+
+    double avg10;
+    if (!read(avg10)) {
+        m_available = false;
+        if (m_active) {
+            m_active = false;
+            return Transition::Ended;
+        }
+        return Transition::None;
+    }
+
+    if (!m_active && avg10 >= m_enterThreshold) {
+        m_active = true;
+        return Transition::Started;
+    }
+    if (m_active && avg10 < m_exitThreshold) {
+        m_active = false;
+        return Transition::Ended;
+    }
+    return Transition::None;
+}
+
+// Read without stdio, which would allocate buffer of file every time
+bool MemoryPressure::read(double &avg10) const {
+    int fd = open(m_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    char buffer[128];
+    ssize_t length = ::read(fd, buffer, sizeof(buffer) - 1);
+    close(fd);
+    if (length <= 0)
+        return false;
+    buffer[length] = '\0';
+
+    // First line: "some avg10=0.00 avg60=0.00 avg300=0.00 total=0"
+    static const char prefix[] = "some avg10=";
+    if (strncmp(buffer, prefix, sizeof(prefix) - 1))
+        return false;
+    const char *value = buffer + sizeof(prefix) - 1;
+    char *end;
+    avg10 = strtod(value, &end);
+    return end != value;
+}
+
+} // namespace Pressure
+} // namespace AskUser
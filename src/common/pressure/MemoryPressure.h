@@ -0,0 +1,77 @@
+/*
+ *  Copyright (c) 2015 Samsung Electronics Co.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/**
+ * @file        MemoryPressure.h
+ * @author      Zofia Abramowska <z.abramowska@samsung.com>
+ * @brief       Definition of memory pressure monitor based on pressure stall information
+ */
+
+#pragma once
+
+#include <chrono>
+#include <string>
+
+namespace AskUser {
+namespace Pressure {
+
+/*
+ * Tracks share of time in which some tasks were stalled waiting for memory, as reported by
+ * kernel in "some avg10" field of /proc/pressure/memory. Pressure starts when it reaches
+ * enter threshold and ends when it drops below exit threshold, so caches do not flap between
+ * shrinking and growing. Kernels without PSI never report pressure.
+ */
+class MemoryPressure {
+public:
+    enum class Transition {
+        None,
+        Started,
+        Ended
+    };
+
+    static const char *const DEFAULT_PATH;
+    static constexpr double DEFAULT_ENTER_THRESHOLD = 10.0;
+    static constexpr double DEFAULT_EXIT_THRESHOLD = 2.0;
+
+    MemoryPressure(const std::string &path = DEFAULT_PATH,
+                   double enterThreshold = DEFAULT_ENTER_THRESHOLD,
+                   double exitThreshold = DEFAULT_EXIT_THRESHOLD,
+                   std::chrono::milliseconds interval = std::chrono::milliseconds(1000));
+
+    // Cheap to call often, file is read at most once per interval
+    Transition poll();
+
+    bool active() const {
+        return m_active;
+    }
+
+    bool available() const {
+        return m_available;
+    }
+
+private:
+    std::string m_path;
+    double m_enterThreshold;
+    double m_exitThreshold;
+    std::chrono::milliseconds m_interval;
+    std::chrono::steady_clock::time_point m_nextRead;
+    bool m_available;
+    bool m_active;
+
+    bool read(double &avg10) const;
+};
+
+} // namespace Pressure
+} // namespace AskUser
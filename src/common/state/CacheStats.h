@@ -0,0 +1,112 @@
+/*
+ *  Copyright (c) 2015 Samsung Electronics Co.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/**
+ * @file        CacheStats.h
+ * @author      Zofia Abramowska <z.abramowska@samsung.com>
+ * @brief       Definition of cache statistics counters
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace AskUser {
+namespace State {
+
+typedef std::atomic<std::uint64_t> Counter;
+
+/*
+ * Counters are written by a single cache and may be read concurrently by other threads or
+ * processes, so relaxed ordering is enough.
+ */
+struct CacheStats {
+    // Reuse distance (number of cache accesses between consecutive uses of a key)
+    // is kept as histogram with buckets [2^(i-1), 2^i)
+    static const unsigned REUSE_DISTANCE_BUCKETS = 24;
+
+    Counter hits;
+    Counter misses;
+    Counter insertions;
+    Counter updates;
+    Counter evictions;
+    Counter expirations;
+    Counter size;
+    // Bytes taken by entries and limit of it, 0 if cache is limited only by number of entries
+    Counter bytes;
+    Counter budget;
+    // Entries kept beyond quotas of their partitions, 0 if cache is not partitioned
+    Counter overflow;
+    Counter reuseDistance[REUSE_DISTANCE_BUCKETS];
+};
+
+// Entries of cache partitioned by user
+struct PartitionStats {
+    static const unsigned USER_SIZE = 32;
+
+    // Empty if slot is not used by any partition
+    char user[USER_SIZE];
+    Counter quota;
+    // Entries within quota and entries of partition moved to shared overflow
+    Counter size;
+    Counter overflow;
+    Counter hits;
+    Counter misses;
+    Counter evictions;
+    // Entries moved to shared overflow to make room for newer ones within quota
+    Counter demotions;
+};
+
+inline void increment(Counter &counter, std::uint64_t value = 1) {
+    counter.fetch_add(value, std::memory_order_relaxed);
+}
+
+inline void set(Counter &counter, std::uint64_t value) {
+    counter.store(value, std::memory_order_relaxed);
+}
+
+inline std::uint64_t get(const Counter &counter) {
+    return counter.load(std::memory_order_relaxed);
+}
+
+inline void copyStats(const CacheStats &from, CacheStats &to) {
+    set(to.hits, get(from.hits));
+    set(to.misses, get(from.misses));
+    set(to.insertions, get(from.insertions));
+    set(to.updates, get(from.updates));
+    set(to.evictions, get(from.evictions));
+    set(to.expirations, get(from.expirations));
+    set(to.size, get(from.size));
+    set(to.bytes, get(from.bytes));
+    set(to.budget, get(from.budget));
+    set(to.overflow, get(from.overflow));
+    for (unsigned i = 0; i < CacheStats::REUSE_DISTANCE_BUCKETS; ++i)
+        set(to.reuseDistance[i], get(from.reuseDistance[i]));
+}
+
+inline void resetPartitionStats(PartitionStats &stats) {
+    stats.user[0] = '\0';
+    set(stats.quota, 0);
+    set(stats.size, 0);
+    set(stats.overflow, 0);
+    set(stats.hits, 0);
+    set(stats.misses, 0);
+    set(stats.evictions, 0);
+    set(stats.demotions, 0);
+}
+
+} // namespace State
+} // namespace AskUser
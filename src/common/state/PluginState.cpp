@@ -0,0 +1,130 @@
+/*
+ *  Copyright (c) 2015 Samsung Electronics Co.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/**
+ * @file        PluginState.cpp
+ * @author      Zofia Abramowska <z.abramowska@samsung.com>
+ * @brief       Implementation of state shared by service plugin with other processes
+ */
+
+#include "PluginState.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char *const pluginStateName = "/askuser-plugin-state";
+const char *const partitionStateName = "/askuser-plugin-partitions";
+const std::uint32_t pluginStateMagic = 0x41534b55; // "ASKU"
+const std::uint32_t pluginStateVersion = 6;
+const std::uint32_t partitionStateVersion = 1;
+const mode_t pluginStateMode = 0644;
+const mode_t partitionStateMode = 0600;
+
+void *mapPage(const char *name, std::size_t size, mode_t mode, bool writable) {
+    int fd = writable ? shm_open(name, O_RDWR | O_CREAT, mode) : shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+        return nullptr;
+
+    struct stat st;
+    bool valid;
+    if (writable) {
+        // Do not depend on umask of process creating the page. Page left by previous version
+        // is truncated, so nothing beyond its current layout stays readable
+        valid = fchmod(fd, mode) == 0 && ftruncate(fd, size) == 0;
+    } else {
+        valid = fstat(fd, &st) == 0 && static_cast<std::size_t>(st.st_size) >= size;
+    }
+
+    void *addr = MAP_FAILED;
+    if (valid) {
+        addr = mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED,
+                    fd, 0);
+    }
+    close(fd);
+    return addr == MAP_FAILED ? nullptr : addr;
+}
+
+} // namespace
+
+namespace AskUser {
+namespace State {
+
+PluginState *mapPluginState(bool writable) {
+    PluginState *state = static_cast<PluginState *>(mapPage(pluginStateName,
+                                                            sizeof(PluginState),
+                                                            pluginStateMode, writable));
+    if (!state)
+        return nullptr;
+
+    if (writable) {
+        if (state->magic != pluginStateMagic || state->version != pluginStateVersion) {
+            // Clients may still cache decisions of epoch left by previous version
+            if (state->magic == pluginStateMagic)
+                state->epoch.fetch_add(1);
+            else
+                state->epoch.store(0);
+            state->version = pluginStateVersion;
+            copyStats(CacheStats(), state->cache);
+            set(state->pressureShrinks, 0);
+            set(state->pressureRestores, 0);
+            state->magic = pluginStateMagic;
+        }
+    } else if (state->magic != pluginStateMagic || state->version != pluginStateVersion) {
+        unmapPluginState(state);
+        return nullptr;
+    }
+
+    return state;
+}
+
+void unmapPluginState(const PluginState *state) {
+    if (state)
+        munmap(const_cast<PluginState *>(state), sizeof(PluginState));
+}
+
+PartitionState *mapPartitionState(bool writable) {
+    PartitionState *state = static_cast<PartitionState *>(mapPage(partitionStateName,
+                                                                  sizeof(PartitionState),
+                                                                  partitionStateMode,
+                                                                  writable));
+    if (!state)
+        return nullptr;
+
+    if (writable) {
+        if (state->magic != pluginStateMagic || state->version != partitionStateVersion) {
+            state->version = partitionStateVersion;
+            for (auto &partition : state->partitions)
+                resetPartitionStats(partition);
+            state->magic = pluginStateMagic;
+        }
+    } else if (state->magic != pluginStateMagic || state->version != partitionStateVersion) {
+        unmapPartitionState(state);
+        return nullptr;
+    }
+
+    return state;
+}
+
+void unmapPartitionState(const PartitionState *state) {
+    if (state)
+        munmap(const_cast<PartitionState *>(state), sizeof(PartitionState));
+}
+
+} // namespace State
+} // namespace AskUser
@@ -0,0 +1,66 @@
+/*
+ *  Copyright (c) 2015 Samsung Electronics Co.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/**
+ * @file        PluginState.h
+ * @author      Zofia Abramowska <z.abramowska@samsung.com>
+ * @brief       Definition of state shared by service plugin with other processes
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include <state/CacheStats.h>
+
+namespace AskUser {
+namespace State {
+
+/*
+ * Page published by service plugin in shared memory. It is writable only by service plugin,
+ * all other processes map it read only. Client plugins of all processes read epoch, so the
+ * page is readable by everyone and holds no identifiers.
+ */
+struct PluginState {
+    std::uint32_t magic;
+    std::uint32_t version;
+    // Changed each time decisions cached by service plugin become invalid. Kept at the same
+    // offset in every version, so it keeps growing across upgrades of plugin
+    std::atomic<std::uint64_t> epoch;
+    CacheStats cache;
+    // Cache shrinks on memory pressure and grows back when pressure ends
+    Counter pressureShrinks;
+    Counter pressureRestores;
+};
+
+// Statistics of partitions name their users, so they are readable only by owner of the page
+struct PartitionState {
+    // Partitions of cache beyond this number are not exported
+    static const unsigned MAX_PARTITIONS = 32;
+
+    std::uint32_t magic;
+    std::uint32_t version;
+    PartitionStats partitions[MAX_PARTITIONS];
+};
+
+PluginState *mapPluginState(bool writable);
+void unmapPluginState(const PluginState *state);
+
+PartitionState *mapPartitionState(bool writable);
+void unmapPartitionState(const PartitionState *state);
+
+} // namespace State
+} // namespace AskUser
@@ -0,0 +1,140 @@
+/*
+ *  Copyright (c) 2015 Samsung Electronics Co.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/**
+ * @file        SpanRing.cpp
+ * @author      Zofia Abramowska <z.abramowska@samsung.com>
+ * @brief       Implementation of ring buffer of timed spans shared with other processes
+ */
+
+#include "SpanRing.h"
+
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+const char *const spanRingPrefix = "/askuser-spans-";
+const std::uint32_t spanRingMagic = 0x41535052; // "ASPR"
+const std::uint32_t spanRingVersion = 1;
+const mode_t spanRingMode = 0644;
+
+std::uint32_t threadId() {
+    static thread_local std::uint32_t tid = static_cast<std::uint32_t>(syscall(SYS_gettid));
+    return tid;
+}
+
+} // namespace
+
+namespace AskUser {
+namespace Trace {
+
+SpanRing *mapSpanRing(const std::string &component, bool writable) {
+    std::string name = spanRingPrefix + component;
+    int fd = writable ? shm_open(name.c_str(), O_RDWR | O_CREAT, spanRingMode)
+                      : shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+        return nullptr;
+
+    struct stat st;
+    bool valid;
+    if (writable) {
+        // Do not depend on umask of process creating the ring
+        valid = fchmod(fd, spanRingMode) == 0 && ftruncate(fd, sizeof(SpanRing)) == 0;
+    } else {
+        valid = fstat(fd, &st) == 0 && static_cast<std::size_t>(st.st_size) >= sizeof(SpanRing);
+    }
+
+    void *addr = MAP_FAILED;
+    if (valid) {
+        addr = mmap(nullptr, sizeof(SpanRing), writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                    MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (addr == MAP_FAILED)
+        return nullptr;
+
+    SpanRing *ring = static_cast<SpanRing *>(addr);
+    if (writable) {
+        // Spans of previous run stay readable, unless layout changed
+        if (ring->magic != spanRingMagic || ring->version != spanRingVersion) {
+            ring->version = spanRingVersion;
+            ring->next.store(0);
+            for (auto &slot : ring->slots)
+                slot.sequence.store(0);
+            ring->magic = spanRingMagic;
+        }
+    } else if (ring->magic != spanRingMagic || ring->version != spanRingVersion) {
+        unmapSpanRing(ring);
+        return nullptr;
+    }
+
+    return ring;
+}
+
+void unmapSpanRing(const SpanRing *ring) {
+    if (ring)
+        munmap(const_cast<SpanRing *>(ring), sizeof(SpanRing));
+}
+
+Timestamp now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<Timestamp>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+CorrelationId newCorrelationId() {
+    static std::atomic<std::uint32_t> counter(static_cast<std::uint32_t>(now()));
+    return (static_cast<CorrelationId>(getpid()) << 32) | counter.fetch_add(1);
+}
+
+void recordSpan(SpanRing *ring, const char *name, CorrelationId correlationId,
+                Timestamp start, Timestamp end) {
+    if (!ring)
+        return;
+
+    std::uint64_t ticket = ring->next.fetch_add(1, std::memory_order_relaxed);
+    SpanSlot &slot = ring->slots[ticket % SpanRing::RING_CAPACITY];
+    slot.sequence.store(2 * ticket + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.span.correlationId = correlationId;
+    slot.span.start = start;
+    slot.span.end = end;
+    slot.span.pid = static_cast<std::uint32_t>(getpid());
+    slot.span.tid = threadId();
+    strncpy(slot.span.name, name, Span::NAME_SIZE - 1);
+    slot.span.name[Span::NAME_SIZE - 1] = '\0';
+
+    slot.sequence.store(2 * ticket + 2, std::memory_order_release);
+}
+
+bool readSpan(const SpanRing &ring, std::uint32_t index, Span &span) {
+    const SpanSlot &slot = ring.slots[index % SpanRing::RING_CAPACITY];
+    std::uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+    if (!sequence || sequence % 2)
+        return false;
+    memcpy(&span, &slot.span, sizeof(span));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.sequence.load(std::memory_order_relaxed) == sequence;
+}
+
+} // namespace Trace
+} // namespace AskUser
@@ -0,0 +1,83 @@
+/*
+ *  Copyright (c) 2015 Samsung Electronics Co.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/**
+ * @file        SpanRing.h
+ * @author      Zofia Abramowska <z.abramowska@samsung.com>
+ * @brief       Definition of ring buffer of timed spans shared with other processes
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace AskUser {
+namespace Trace {
+
+// Carried with request from service plugin through cynara to agent and back, 0 if unknown
+typedef std::uint64_t CorrelationId;
+// Nanoseconds of monotonic clock, which is common for all processes
+typedef std::uint64_t Timestamp;
+
+struct Span {
+    static const unsigned NAME_SIZE = 24;
+
+    CorrelationId correlationId;
+    Timestamp start;
+    Timestamp end;
+    std::uint32_t pid;
+    std::uint32_t tid;
+    char name[NAME_SIZE];
+};
+
+/*
+ * Slot is written under sequence lock: odd sequence means write in progress. Reader copies
+ * span and drops it if sequence changed meanwhile.
+ */
+struct SpanSlot {
+    std::atomic<std::uint64_t> sequence;
+    Span span;
+};
+
+/*
+ * Last RING_CAPACITY spans of one component, e.g. service plugin or agent, published in
+ * shared memory. Recording does not allocate nor lock, so it may be done on every request.
+ */
+struct SpanRing {
+    static const std::uint32_t RING_CAPACITY = 4096;
+
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::atomic<std::uint64_t> next;
+    SpanSlot slots[RING_CAPACITY];
+};
+
+SpanRing *mapSpanRing(const std::string &component, bool writable);
+void unmapSpanRing(const SpanRing *ring);
+
+Timestamp now();
+// Process id and counter starting at random point, so ids of different processes do not meet
+CorrelationId newCorrelationId();
+
+// Does nothing if ring could not be mapped
+void recordSpan(SpanRing *ring, const char *name, CorrelationId correlationId,
+                Timestamp start, Timestamp end);
+// Returns false if slot is empty or was overwritten while being read
+bool readSpan(const SpanRing &ring, std::uint32_t index, Span &span);
+
+} // namespace Trace
+} // namespace AskUser
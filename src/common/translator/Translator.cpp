@@ -23,37 +23,97 @@
 
 #include <types/AgentErrorMsg.h>
 
+#include <cstdio>
 #include <limits>
 #include <stdexcept>
-#include <sstream>
+
+namespace {
+
+const char separator = ' ';
+
+// Parses "<length> " starting at pos, returns length
+std::size_t readLength(const char *data, std::size_t size, std::size_t &pos) {
+    std::size_t length = 0;
+    std::size_t digits = 0;
+    for (; pos < size && data[pos] >= '0' && data[pos] <= '9'; ++pos, ++digits) {
+        if (length > (std::numeric_limits<std::size_t>::max() - 9) / 10)
+            throw AskUser::Translator::TranslateErrorException("Too long request member");
+        length = length * 10 + (data[pos] - '0');
+    }
+    if (!digits || pos >= size || data[pos] != separator)
+        throw AskUser::Translator::TranslateErrorException("Malformed request member length");
+    ++pos;
+    if (size - pos < length)
+        throw AskUser::Translator::TranslateErrorException("Truncated request member");
+    return length;
+}
+
+void skipSeparator(const char *data, std::size_t size, std::size_t &pos) {
+    // Last separator is optional
+    if (pos < size && data[pos] == separator)
+        ++pos;
+}
+
+// Parses "<length> <characters> " starting at pos
+void readMember(const char *data, std::size_t size, std::size_t &pos, std::string &member) {
+    std::size_t length = readLength(data, size, pos);
+    member.assign(data + pos, length);
+    pos += length;
+    skipSeparator(data, size, pos);
+}
+
+// Parses "<length> <digits> " starting at pos, without allocating
+void readNumber(const char *data, std::size_t size, std::size_t &pos, std::uint64_t &number) {
+    std::size_t length = readLength(data, size, pos);
+    if (!length)
+        throw AskUser::Translator::TranslateErrorException("Malformed request number");
+    number = 0;
+    for (std::size_t end = pos + length; pos < end; ++pos) {
+        if (data[pos] < '0' || data[pos] > '9'
+                || number > (std::numeric_limits<std::uint64_t>::max() - 9) / 10)
+            throw AskUser::Translator::TranslateErrorException("Malformed request number");
+        number = number * 10 + (data[pos] - '0');
+    }
+    skipSeparator(data, size, pos);
+}
+
+} // namespace
 
 namespace AskUser {
 namespace Translator {
 namespace Agent {
 
 RequestData dataToRequest(const Cynara::PluginData &data) {
-    std::stringstream stream(data);
-    std::size_t strSize;
-    std::string members[3];
-
-    for (auto &member : members) {
-        stream >> strSize;
-        std::vector<char> buffer(strSize, '\0');
-        char separator;
-        //Consume separator
-        stream.read(&separator, 1);
-        stream.read(buffer.data(), strSize);
-        //read doesn't append null
-        member.assign(buffer.begin(), buffer.end());
-    }
-    return RequestData{members[0], members[1], members[2]};
+    RequestData request;
+    dataToRequest(data.data(), data.size(), request);
+    return request;
+}
+
+void dataToRequest(const char *data, std::size_t size, RequestData &request) {
+    std::size_t pos = 0;
+    readMember(data, size, pos, request.client);
+    readMember(data, size, pos, request.user);
+    readMember(data, size, pos, request.privilege);
+    request.correlationId = 0;
+    if (pos < size)
+        readNumber(data, size, pos, request.correlationId);
 }
 
 Cynara::PluginData answerToData(Cynara::PolicyType answer, const std::string &errMsg) {
-    if (errMsg.empty())
-        return std::to_string(answer);
-    else
-        return errMsg;
+    Cynara::PluginData data;
+    answerToData(answer, errMsg, data);
+    return data;
+}
+
+void answerToData(Cynara::PolicyType answer, const std::string &errMsg,
+                  Cynara::PluginData &data) {
+    if (!errMsg.empty()) {
+        data.assign(errMsg);
+        return;
+    }
+    char buffer[std::numeric_limits<Cynara::PolicyType>::digits10 + 3];
+    int length = snprintf(buffer, sizeof(buffer), "%u", static_cast<unsigned>(answer));
+    data.assign(buffer, length);
 }
 
 } //namespace Agent
@@ -82,12 +142,17 @@ Cynara::PolicyType dataToAnswer(const Cynara::PluginData &data) {
 
 Cynara::PluginData requestToData(const std::string &client,
                                  const std::string &user,
-                                 const std::string &privilege)
+                                 const std::string &privilege,
+                                 std::uint64_t correlationId)
 {
-    const char separator = ' ';
-    return std::to_string(client.length()) + separator + client + separator
+    Cynara::PluginData data = std::to_string(client.length()) + separator + client + separator
             + std::to_string(user.length()) + separator + user + separator
             + std::to_string(privilege.length()) + separator + privilege + separator;
+    if (correlationId) {
+        std::string number = std::to_string(correlationId);
+        data += std::to_string(number.length()) + separator + number + separator;
+    }
+    return data;
 }
 
 } //namespace Plugin
@@ -25,6 +25,7 @@
 #include <types/SupportedTypes.h>
 #include <cynara-plugin.h>
 
+#include <cstdint>
 #include <exception>
 #include <string>
 
@@ -44,13 +45,20 @@ private:
 namespace Agent {
     RequestData dataToRequest(const Cynara::PluginData &data);
     Cynara::PluginData answerToData(Cynara::PolicyType answer, const std::string &errMsg);
+
+    // Variants reusing memory of output, they do not allocate once it is large enough
+    void dataToRequest(const char *data, std::size_t size, RequestData &request);
+    void answerToData(Cynara::PolicyType answer, const std::string &errMsg,
+                      Cynara::PluginData &data);
 } // namespace Agent
 
 namespace Plugin {
     Cynara::PolicyType dataToAnswer(const Cynara::PluginData &data);
+    // Correlation id is optional 4th member, agents not knowing it skip it
     Cynara::PluginData requestToData(const std::string &client,
                                      const std::string &user,
-                                     const std::string &privilege);
+                                     const std::string &privilege,
+                                     std::uint64_t correlationId = 0);
 } // namespace Plugin
 
 } // namespace Translator
@@ -21,6 +21,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
 
 namespace AskUser {
@@ -29,6 +30,8 @@ struct RequestData {
     std::string client;
     std::string user;
     std::string privilege;
+    // Identifies request in traces of plugin and agent, 0 if plugin did not send it
+    std::uint64_t correlationId;
 };
 
 } // namespace AskUser
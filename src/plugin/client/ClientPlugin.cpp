@@ -19,12 +19,14 @@
  * @brief       Implementation of cynara client side AskUser plugin.
  */
 
+#include <cstdlib>
 #include <cynara-client-plugin.h>
 #include <cynara-error.h>
 #include <vector>
 
 #include <attributes/attributes.h>
 #include <log/log.h>
+#include <state/PluginState.h>
 #include <types/PolicyDescription.h>
 #include <types/SupportedTypes.h>
 
@@ -34,20 +36,30 @@ namespace AskUser {
 const std::vector<PolicyDescription> clientDescriptions = {
         { SupportedTypes::Client::ALLOW_ONCE, "Allow once" },
         { SupportedTypes::Client::ALLOW_PER_SESSION, "Allow per session" },
+        { SupportedTypes::Client::ALLOW_PER_LIFE, "Allow per life" },
 
         { SupportedTypes::Client::DENY_ONCE, "Deny once" },
-        { SupportedTypes::Client::DENY_PER_SESSION, "Deny per session" }
+        { SupportedTypes::Client::DENY_PER_SESSION, "Deny per session" },
+        { SupportedTypes::Client::DENY_PER_LIFE, "Deny per life" }
 };
 
 class ClientPlugin : public ClientPluginInterface {
 public:
+    ClientPlugin() : m_state(nullptr) {}
+
+    ~ClientPlugin() {
+        State::unmapPluginState(m_state);
+    }
+
     const std::vector<PolicyDescription> &getSupportedPolicyDescr() {
         return clientDescriptions;
     }
 
     bool isCacheable(const ClientSession &session UNUSED, const PolicyResult &result) {
         return (result.policyType() == SupportedTypes::Client::ALLOW_PER_SESSION
-                || result.policyType() == SupportedTypes::Client::DENY_PER_SESSION);
+                || result.policyType() == SupportedTypes::Client::DENY_PER_SESSION
+                || result.policyType() == SupportedTypes::Client::ALLOW_PER_LIFE
+                || result.policyType() == SupportedTypes::Client::DENY_PER_LIFE);
     }
 
     bool isUsable(const ClientSession &session,
@@ -66,22 +78,54 @@ public:
             LOGD("Previous session <" << prevSession << "> does not match current session <"
                     << session << ">");
             return false;
+        case SupportedTypes::Client::ALLOW_PER_LIFE:
+        case SupportedTypes::Client::DENY_PER_LIFE:
+            return isCurrentEpoch(result);
         default:
             return false;
         }
     }
 
-    void invalidate() {}
+    void invalidate() {
+        // Shared state will be mapped again on next check
+        State::unmapPluginState(m_state);
+        m_state = nullptr;
+    }
 
     virtual int toResult(const ClientSession &session UNUSED, PolicyResult &result) {
         switch (result.policyType()) {
             case SupportedTypes::Client::ALLOW_ONCE:
             case SupportedTypes::Client::ALLOW_PER_SESSION:
+            case SupportedTypes::Client::ALLOW_PER_LIFE:
                 return CYNARA_API_ACCESS_ALLOWED;
             default:
                 return CYNARA_API_ACCESS_DENIED;
         }
     }
+
+private:
+    const State::PluginState *m_state;
+
+    bool isCurrentEpoch(const PolicyResult &result) {
+        if (!m_state) {
+            m_state = State::mapPluginState(false);
+            if (!m_state) {
+                LOGD("Shared plugin state not available");
+                return false;
+            }
+        }
+
+        const auto &metadata = result.metadata();
+        if (metadata.empty())
+            return false;
+
+        char *end;
+        unsigned long long epoch = strtoull(metadata.c_str(), &end, 10);
+        if (*end != '\0')
+            return false;
+
+        return epoch == m_state->epoch.load();
+    }
 };
 
 } // namespace AskUser
@@ -16,109 +16,764 @@
 /**
  * @file        CapacityCache.h
  * @author      Zofia Abramowska <z.abramowska@samsung.com>
- * @brief       LRU cache container template declaration.
+ * @brief       Cache container template declaration.
  */
 
 #pragma once
 
+#include <array>
+#include <chrono>
+#include <cstdint>
 #include <iostream>
 #include <functional>
-#include <list>
+#include <iterator>
+#include <limits>
 #include <string>
 #include <tuple>
 #include <unordered_map>
 
 #include <log/log.h>
+#include <state/CacheStats.h>
+
+#include "EvictionPolicy.h"
 
 namespace Plugin {
 
-template<class Key, class Value>
+typedef AskUser::State::CacheStats CacheStats;
+typedef AskUser::State::PartitionStats PartitionStats;
+
+// Memory owned by value outside of its object, specialize for values holding heap memory
+template<class Value>
+struct ValueBytes {
+    std::size_t operator()(const Value &) const {
+        return 0;
+    }
+};
+
+/*
+ * Key is a fixed size array of components (e.g. client, user and privilege). Cached values
+ * can be invalidated all at once or selectively for given value of any component. Both
+ * operations take constant time, invalidated entries are discarded lazily and all of them
+ * before anything valid is evicted. Entries invalidated all at once are not counted in size
+ * of cache nor in its statistics.
+ *
+ * Size of cache is limited by number of entries and, optionally, by budget of bytes. Bytes of
+ * entry are estimated from sizes of map node, of key tracked by eviction policy and of memory
+ * owned by value; allocator overhead and rehashing of map are not counted.
+ *
+ * Cache can be partitioned by one key component (e.g. user). Every partition keeps up to its
+ * quota of entries in its own eviction policy, older entries are moved to overflow shared by
+ * all partitions, which never exceeds its limit. When cache is full, entries are evicted from
+ * overflow first, then from partition of inserted or updated entry. If neither has any entry,
+ * new entry is not cached, so entries within quota of one partition are not evicted to make
+ * room for another one. Only lowering capacity or budget evicts from the largest partition.
+ */
+template<class Key, class Value, template<class> class Policy = LRUPolicy>
 class CapacityCache {
 public:
-    //using KeyHasherFun = std::function<std::string(const Key &)>;
-    typedef std::function<std::string(const Key &)> KeyHasherFun;
+    typedef typename Key::value_type KeyComponent;
+    static const std::size_t KEY_COMPONENTS = std::tuple_size<Key>::value;
+
+    typedef std::chrono::steady_clock Clock;
     static const std::size_t CACHE_DEFAULT_CAPACITY = 100;
+    static const std::size_t CACHE_NO_BUDGET = 0;
+    // Number of entries checked for expired entries on every update
+    static const std::size_t CACHE_SWEEP_ENTRIES = 4;
+    static const std::size_t CACHE_NO_LIMIT = std::numeric_limits<std::size_t>::max();
 
-    CapacityCache(const std::function<std::string(const Key&)> &func,
-                  std::size_t capacity = CACHE_DEFAULT_CAPACITY)
+    // Gives place for statistics of new partition, nullptr if they should not be exported
+    typedef std::function<PartitionStats *(const KeyComponent &)> PartitionStatsBinder;
+
+    explicit CapacityCache(std::size_t capacity = CACHE_DEFAULT_CAPACITY)
         : m_capacity(capacity),
-          m_keyHasher(func)
+          m_budget(CACHE_NO_BUDGET),
+          m_bytes(0),
+          m_staleEntries(0),
+          m_staleBytes(0),
+          m_staleOverflow(0),
+          m_partitionComponent(KEY_COMPONENTS),
+          m_defaultQuota(0),
+          m_overflowLimit(CACHE_NO_LIMIT),
+          m_overflowSize(0),
+          m_expiringCount(0),
+          m_sweepCursor(),
+          m_sweepCursorValid(false),
+          m_generation(0),
+          m_validFrom(0),
+          m_selectiveCount(0),
+          m_invalidated(false),
+          m_accessCount(0),
+          m_ownStats(),
+          m_stats(&m_ownStats)
     {}
 
     bool get(const Key &key, Value &value);
-    bool update(const Key &key, const Value &value);
+    // Entry with zero ttl never expires
+    bool update(const Key &key, const Value &value,
+                Clock::duration ttl = Clock::duration::zero());
     void clear();
+    void invalidate(std::size_t component, const KeyComponent &value);
+
+    // Both evict entries immediately if cache no longer fits
+    void setCapacity(std::size_t capacity);
+    void setBudget(std::size_t bytes);
+
+    // Quotas and overflow limit count entries, they apply within capacity and budget of cache
+    void setPartitioning(std::size_t component, std::size_t defaultQuota,
+                         std::size_t overflowLimit = CACHE_NO_LIMIT);
+    void disablePartitioning();
+    void setQuota(const KeyComponent &value, std::size_t quota);
+    // Partitions with custom quota get default one
+    void resetQuotas();
+    void bindPartitionStats(PartitionStatsBinder binder) {
+        m_partitionStatsBinder = binder;
+    }
+
+    std::size_t bytes() const {
+        return m_bytes - m_staleBytes;
+    }
+
+    const CacheStats &stats() const {
+        return *m_stats;
+    }
+
+    // Makes cache keep its statistics in given place, e.g. in shared memory
+    void bindStats(CacheStats &stats) {
+        AskUser::State::copyStats(*m_stats, stats);
+        m_stats = &stats;
+    }
 
 private:
-    typedef std::list<std::string> KeyUsageList;
-    typedef std::unordered_map<std::string, std::pair<Value, KeyUsageList::iterator>> KeyValueMap;
+    typedef Policy<Key> EvictionPolicy;
+    typedef std::uint64_t Generation;
+    struct Partition {
+        Partition() : size(0), overflow(0), staleSize(0), staleOverflow(0), quota(0),
+                      customQuota(false), ownStats(), stats(&ownStats) {}
 
-    void evict();
+        EvictionPolicy policy;
+        std::size_t size;
+        std::size_t overflow;
+        // Part of size and overflow invalidated by clear() and not discarded yet
+        std::size_t staleSize;
+        std::size_t staleOverflow;
+        std::size_t quota;
+        bool customQuota;
+        PartitionStats ownStats;
+        PartitionStats *stats;
+    };
+    struct Entry {
+        Value value;
+        // Handle is kept by policy of partition if entry is within its quota, by overflow
+        // policy otherwise
+        typename EvictionPolicy::Handle handle;
+        Partition *partition;
+        bool inQuota;
+        Clock::time_point expiry;
+        Generation generation;
+        std::uint64_t lastAccess;
+        std::size_t bytes;
+    };
+    typedef std::unordered_map<Key, Entry, KeyHash<Key>> KeyValueMap;
+
+    // Map node holds next pointer and cached hash besides the pair, bucket array holds
+    // a pointer per entry at maximal load factor
+    static const std::size_t MAP_ENTRY_BYTES = sizeof(typename KeyValueMap::value_type)
+                                               + 2 * sizeof(void *) + sizeof(std::size_t);
+
+    static std::size_t entryBytes(const Value &value) {
+        return MAP_ENTRY_BYTES + EvictionPolicy::KEY_BYTES + ValueBytes<Value>()(value);
+    }
+    typedef std::unordered_map<KeyComponent, Generation> ComponentGenerations;
+    typedef std::unordered_map<KeyComponent, Partition> Partitions;
+
+    bool evict(Partition *owner = nullptr);
+    typename KeyValueMap::iterator erase(typename KeyValueMap::iterator it, bool evicted = false);
+    bool isPartitioned() const {
+        return m_partitionComponent < KEY_COMPONENTS;
+    }
+    Partition &partitionOf(const KeyComponent &value);
+    void insertInto(Partition *partition, const Key &key, Entry &entry);
+    void demote(Partition &partition);
+    void promote(const Key &key, Entry &entry);
+    void fitQuota(Partition &partition);
+    void trimOverflow();
+    void setPartitionSize(Partition &partition);
+    void sweep();
+    void compact();
+    void shrink(Partition *owner = nullptr);
+    bool reclaim();
+    void publishSize();
+    bool fits(std::size_t entries, std::size_t bytes) const;
+    void recordAccess(Entry &entry);
+    bool isValid(const Key &key, const Entry &entry) const;
+    bool isStale(const Entry &entry) const {
+        return entry.generation < m_validFrom;
+    }
+
+    static bool isExpiring(const Entry &entry) {
+        return entry.expiry != Clock::time_point::max();
+    }
 
     std::size_t m_capacity;
+    std::size_t m_budget;
+    std::size_t m_bytes;
+    // Entries, their bytes and part of overflow invalidated by clear() and not discarded yet
+    std::size_t m_staleEntries;
+    std::size_t m_staleBytes;
+    std::size_t m_staleOverflow;
 
-    KeyHasherFun m_keyHasher;
-    KeyUsageList m_keyUsage;
+    // Policy of entries beyond quotas of partitions, or of all entries if not partitioned
+    EvictionPolicy m_policy;
     KeyValueMap m_keyValue;
+
+    std::size_t m_partitionComponent;
+    std::size_t m_defaultQuota;
+    std::size_t m_overflowLimit;
+    std::size_t m_overflowSize;
+    Partitions m_partitions;
+    PartitionStatsBinder m_partitionStatsBinder;
+
+    std::size_t m_expiringCount;
+    // Key of entry next sweep starts with
+    Key m_sweepCursor;
+    bool m_sweepCursorValid;
+
+    // Entries stamped with generation older than m_validFrom or than generation in which their
+    // key component was invalidated are no longer valid
+    Generation m_generation;
+    Generation m_validFrom;
+    std::array<ComponentGenerations, KEY_COMPONENTS> m_componentGenerations;
+    std::size_t m_selectiveCount;
+    bool m_invalidated;
+
+    std::uint64_t m_accessCount;
+    CacheStats m_ownStats;
+    CacheStats *m_stats;
 };
 
-template<class Key, class Value>
-bool CapacityCache<Key, Value>::get(const Key &key, Value &value) {
-    auto resultIt = m_keyValue.find(m_keyHasher(key));
+template<class Key, class Value, template<class> class Policy>
+bool CapacityCache<Key, Value, Policy>::get(const Key &key, Value &value) {
+    ++m_accessCount;
+    auto resultIt = m_keyValue.find(key);
     //Do we have entry in cache?
     if (resultIt == m_keyValue.end()) {
+        AskUser::State::increment(m_stats->misses);
+        if (isPartitioned()) {
+            auto partitionIt = m_partitions.find(key[m_partitionComponent]);
+            if (partitionIt != m_partitions.end())
+                AskUser::State::increment(partitionIt->second.stats->misses);
+        }
+        return false;
+    }
+
+    Entry &entry = resultIt->second;
+    if (!isValid(key, entry)) {
+        LOGD("Invalidated: " << key);
+        AskUser::State::increment(m_stats->misses);
+        if (entry.partition)
+            AskUser::State::increment(entry.partition->stats->misses);
+        erase(resultIt);
         return false;
     }
-    LOGD("Found: " << key << " with value:" << resultIt->second.first);
+    if (isExpiring(entry) && entry.expiry <= Clock::now()) {
+        LOGD("Expired: " << key);
+        AskUser::State::increment(m_stats->expirations);
+        AskUser::State::increment(m_stats->misses);
+        if (entry.partition)
+            AskUser::State::increment(entry.partition->stats->misses);
+        erase(resultIt);
+        return false;
+    }
+    LOGD("Found: " << key << " with value:" << entry.value);
+
+    AskUser::State::increment(m_stats->hits);
+    recordAccess(entry);
+    if (!entry.partition) {
+        m_policy.touch(entry.handle);
+    } else {
+        AskUser::State::increment(entry.partition->stats->hits);
+        if (entry.inQuota)
+            entry.partition->policy.touch(entry.handle);
+        else
+            promote(key, entry);
+    }
+
+    value = entry.value;
+    return true;
+}
+
+template<class Key, class Value, template<class> class Policy>
+void CapacityCache<Key, Value, Policy>::clear(void) {
+    m_validFrom = ++m_generation;
+    m_invalidated = true;
+    m_staleEntries = m_keyValue.size();
+    m_staleBytes = m_bytes;
+    m_staleOverflow = m_overflowSize;
+    for (auto &partition : m_partitions) {
+        partition.second.staleSize = partition.second.size;
+        partition.second.staleOverflow = partition.second.overflow;
+        setPartitionSize(partition.second);
+    }
+    publishSize();
+    if (m_selectiveCount) {
+        for (auto &generations : m_componentGenerations)
+            generations.clear();
+        m_selectiveCount = 0;
+    }
+}
+
+template<class Key, class Value, template<class> class Policy>
+void CapacityCache<Key, Value, Policy>::invalidate(std::size_t component,
+                                                   const KeyComponent &value) {
+    m_componentGenerations[component][value] = ++m_generation;
+    m_invalidated = true;
+    // Do not let invalidation records grow beyond size of cache
+    if (++m_selectiveCount > m_keyValue.size())
+        compact();
+}
 
-    auto usageIt = resultIt->second.second;
-    m_keyUsage.splice(m_keyUsage.begin(), m_keyUsage, usageIt);
+template<class Key, class Value, template<class> class Policy>
+bool CapacityCache<Key, Value, Policy>::isValid(const Key &key, const Entry &entry) const {
+    if (entry.generation < m_validFrom)
+        return false;
+    if (!m_selectiveCount)
+        return true;
 
-    value = resultIt->second.first;
+    for (std::size_t i = 0; i < KEY_COMPONENTS; ++i) {
+        const auto &generations = m_componentGenerations[i];
+        if (generations.empty())
+            continue;
+        auto it = generations.find(key[i]);
+        if (it != generations.end() && entry.generation < it->second)
+            return false;
+    }
     return true;
 }
 
-template<class Key, class Value>
-void CapacityCache<Key, Value>::clear(void) {
-    m_keyUsage.clear();
-    m_keyValue.clear();
+// Discards all invalidated entries, so invalidation records are no longer needed
+template<class Key, class Value, template<class> class Policy>
+void CapacityCache<Key, Value, Policy>::compact(void) {
+    for (auto it = m_keyValue.begin(); it != m_keyValue.end();) {
+        if (!isValid(it->first, it->second))
+            it = erase(it);
+        else
+            ++it;
+    }
+    for (auto &generations : m_componentGenerations)
+        generations.clear();
+    m_selectiveCount = 0;
+    m_invalidated = false;
 }
 
-template <class Key, class Value>
-void CapacityCache<Key, Value>::evict(void) {
-    auto lastUsedKey = m_keyUsage.back();
-    m_keyUsage.pop_back();
+template<class Key, class Value, template<class> class Policy>
+void CapacityCache<Key, Value, Policy>::setCapacity(std::size_t capacity) {
+    m_capacity = capacity;
+    shrink();
+}
 
-    auto value_it = m_keyValue.find(lastUsedKey);
-    m_keyValue.erase(value_it);
+template<class Key, class Value, template<class> class Policy>
+void CapacityCache<Key, Value, Policy>::setBudget(std::size_t bytes) {
+    m_budget = bytes;
+    AskUser::State::set(m_stats->budget, m_budget);
+    shrink();
 }
 
-template <class Key, class Value>
-bool CapacityCache<Key, Value>::update(const Key &key, const Value &value) {
-    if (m_capacity == 0) {
-        LOGD("Cache size is 0");
+template<class Key, class Value, template<class> class Policy>
+bool CapacityCache<Key, Value, Policy>::fits(std::size_t entries, std::size_t bytes) const {
+    return entries <= m_capacity && (m_budget == CACHE_NO_BUDGET || bytes <= m_budget);
+}
+
+template<class Key, class Value, template<class> class Policy>
+void CapacityCache<Key, Value, Policy>::shrink(Partition *owner) {
+    while (!m_keyValue.empty() && !fits(m_keyValue.size(), m_bytes)) {
+        if (!evict(owner))
+            return;
+    }
+}
+
+template<class Key, class Value, template<class> class Policy>
+typename CapacityCache<Key, Value, Policy>::KeyValueMap::iterator
+CapacityCache<Key, Value, Policy>::erase(typename KeyValueMap::iterator it, bool evicted) {
+    if (isExpiring(it->second))
+        --m_expiringCount;
+    m_bytes -= it->second.bytes;
+    Partition *partition = it->second.partition;
+    if (isStale(it->second)) {
+        --m_staleEntries;
+        m_staleBytes -= it->second.bytes;
+        if (it->second.inQuota) {
+            --partition->staleSize;
+        } else {
+            --m_staleOverflow;
+            if (partition)
+                --partition->staleOverflow;
+        }
+    }
+    EvictionPolicy &policy = it->second.inQuota ? partition->policy : m_policy;
+    if (evicted)
+        policy.evict(it->second.handle);
+    else
+        policy.erase(it->second.handle);
+    if (it->second.inQuota) {
+        --partition->size;
+    } else {
+        --m_overflowSize;
+        if (partition)
+            --partition->overflow;
+    }
+    auto next = m_keyValue.erase(it);
+    if (partition)
+        setPartitionSize(*partition);
+    publishSize();
+    return next;
+}
+
+// Discards invalidated entries, returns true if any was found
+template<class Key, class Value, template<class> class Policy>
+bool CapacityCache<Key, Value, Policy>::reclaim(void) {
+    if (!m_invalidated)
         return false;
+    std::size_t size = m_keyValue.size();
+    compact();
+    return m_keyValue.size() < size;
+}
+
+template<class Key, class Value, template<class> class Policy>
+void CapacityCache<Key, Value, Policy>::publishSize(void) {
+    AskUser::State::set(m_stats->size, m_keyValue.size() - m_staleEntries);
+    AskUser::State::set(m_stats->bytes, m_bytes - m_staleBytes);
+}
+
+/*
+ * Invalidated entries are discarded all at once before any valid one is evicted. Otherwise
+ * overflow goes first, then entries of owner partition. Without owner, e.g. when cache
+ * shrinks, entries of the largest partition go. Returns false if owner has nothing to evict.
+ */
+template<class Key, class Value, template<class> class Policy>
+bool CapacityCache<Key, Value, Policy>::evict(Partition *owner) {
+    if (reclaim())
+        return true;
+    EvictionPolicy *policy = &m_policy;
+    if (!m_overflowSize) {
+        if (owner && !owner->size)
+            return false;
+        if (!owner) {
+            for (auto &partition : m_partitions) {
+                if (!owner || partition.second.size > owner->size)
+                    owner = &partition.second;
+            }
+        }
+        policy = &owner->policy;
+    }
+    auto value_it = m_keyValue.find(policy->victim());
+    if (value_it->second.partition)
+        AskUser::State::increment(value_it->second.partition->stats->evictions);
+    erase(value_it, true);
+    AskUser::State::increment(m_stats->evictions);
+    return true;
+}
+
+template<class Key, class Value, template<class> class Policy>
+typename CapacityCache<Key, Value, Policy>::Partition &
+CapacityCache<Key, Value, Policy>::partitionOf(const KeyComponent &value) {
+    auto it = m_partitions.find(value);
+    if (it != m_partitions.end())
+        return it->second;
+
+    Partition &partition = m_partitions[value];
+    partition.quota = m_defaultQuota;
+    if (m_partitionStatsBinder) {
+        PartitionStats *stats = m_partitionStatsBinder(value);
+        if (stats)
+            partition.stats = stats;
+    }
+    AskUser::State::set(partition.stats->quota, partition.quota);
+    return partition;
+}
+
+// Entry of full partition takes place of its least valuable entry, which goes to overflow
+template<class Key, class Value, template<class> class Policy>
+void CapacityCache<Key, Value, Policy>::insertInto(Partition *partition, const Key &key,
+                                                   Entry &entry) {
+    entry.partition = partition;
+    entry.inQuota = partition && partition->quota;
+    if (!entry.inQuota) {
+        entry.handle = m_policy.insert(key);
+        ++m_overflowSize;
+        if (partition)
+            ++partition->overflow;
+    } else {
+        if (partition->size >= partition->quota)
+            reclaim();
+        if (partition->size >= partition->quota)
+            demote(*partition);
+        entry.handle = partition->policy.insert(key);
+        ++partition->size;
+    }
+    if (partition)
+        setPartitionSize(*partition);
+}
+
+template<class Key, class Value, template<class> class Policy>
+void CapacityCache<Key, Value, Policy>::demote(Partition &partition) {
+    Key key = partition.policy.victim();
+    Entry &entry = m_keyValue.find(key)->second;
+    partition.policy.erase(entry.handle);
+    --partition.size;
+    entry.handle = m_policy.insert(key);
+    entry.inQuota = false;
+    ++partition.overflow;
+    ++m_overflowSize;
+    AskUser::State::increment(partition.stats->demotions);
+}
+
+// Used entry of overflow swaps place with least valuable entry of its full partition, which
+// may then be evicted if overflow is over its limit
+template<class Key, class Value, template<class> class Policy>
+void CapacityCache<Key, Value, Policy>::promote(const Key &key, Entry &entry) {
+    Partition &partition = *entry.partition;
+    if (!partition.quota) {
+        m_policy.touch(entry.handle);
+        return;
     }
-    if (m_keyValue.size() == m_capacity) {
-        LOGD("Capacity [" << m_capacity << "] reached");
+    m_policy.erase(entry.handle);
+    --partition.overflow;
+    --m_overflowSize;
+    if (partition.size >= partition.quota)
+        reclaim();
+    if (partition.size >= partition.quota)
+        demote(partition);
+    entry.handle = partition.policy.insert(key);
+    entry.inQuota = true;
+    ++partition.size;
+    setPartitionSize(partition);
+    trimOverflow();
+}
+
+template<class Key, class Value, template<class> class Policy>
+void CapacityCache<Key, Value, Policy>::fitQuota(Partition &partition) {
+    AskUser::State::set(partition.stats->quota, partition.quota);
+    if (partition.size > partition.quota)
+        reclaim();
+    while (partition.size > partition.quota)
+        demote(partition);
+    setPartitionSize(partition);
+}
+
+template<class Key, class Value, template<class> class Policy>
+void CapacityCache<Key, Value, Policy>::trimOverflow(void) {
+    while (m_overflowSize > m_overflowLimit)
         evict();
+}
+
+template<class Key, class Value, template<class> class Policy>
+void CapacityCache<Key, Value, Policy>::setPartitionSize(Partition &partition) {
+    AskUser::State::set(partition.stats->size, partition.size - partition.staleSize);
+    AskUser::State::set(partition.stats->overflow, partition.overflow - partition.staleOverflow);
+    AskUser::State::set(m_stats->overflow, m_overflowSize - m_staleOverflow);
+}
+
+/*
+ * Entries already cached stay in overflow of their partitions and get within quota once they
+ * are used again.
+ */
+template<class Key, class Value, template<class> class Policy>
+void CapacityCache<Key, Value, Policy>::setPartitioning(std::size_t component,
+                                                        std::size_t defaultQuota,
+                                                        std::size_t overflowLimit) {
+    if (component != m_partitionComponent) {
+        disablePartitioning();
+        // Invalidated entries would otherwise move between partitions and overflow
+        reclaim();
+        m_partitionComponent = component;
+        for (auto &keyValue : m_keyValue) {
+            Partition &owner = partitionOf(keyValue.first[component]);
+            keyValue.second.partition = &owner;
+            ++owner.overflow;
+            setPartitionSize(owner);
+        }
+    }
+
+    m_defaultQuota = defaultQuota;
+    m_overflowLimit = overflowLimit;
+    for (auto &partition : m_partitions) {
+        if (!partition.second.customQuota) {
+            partition.second.quota = m_defaultQuota;
+            fitQuota(partition.second);
+        }
+    }
+    trimOverflow();
+}
+
+template<class Key, class Value, template<class> class Policy>
+void CapacityCache<Key, Value, Policy>::disablePartitioning(void) {
+    if (!isPartitioned())
+        return;
+
+    // Invalidated entries would otherwise move between partitions and overflow
+    reclaim();
+    for (auto &keyValue : m_keyValue) {
+        Entry &entry = keyValue.second;
+        if (entry.inQuota) {
+            entry.partition->policy.erase(entry.handle);
+            entry.handle = m_policy.insert(keyValue.first);
+            entry.inQuota = false;
+            ++m_overflowSize;
+        }
+        entry.partition = nullptr;
+    }
+    m_partitions.clear();
+    m_partitionComponent = KEY_COMPONENTS;
+    m_defaultQuota = 0;
+    m_overflowLimit = CACHE_NO_LIMIT;
+    AskUser::State::set(m_stats->overflow, 0);
+}
+
+template<class Key, class Value, template<class> class Policy>
+void CapacityCache<Key, Value, Policy>::setQuota(const KeyComponent &value, std::size_t quota) {
+    if (!isPartitioned())
+        return;
+
+    Partition &owner = partitionOf(value);
+    owner.quota = quota;
+    owner.customQuota = true;
+    fitQuota(owner);
+    trimOverflow();
+}
+
+template<class Key, class Value, template<class> class Policy>
+void CapacityCache<Key, Value, Policy>::resetQuotas(void) {
+    for (auto &partition : m_partitions) {
+        if (partition.second.customQuota) {
+            partition.second.quota = m_defaultQuota;
+            partition.second.customQuota = false;
+            fitQuota(partition.second);
+        }
+    }
+    trimOverflow();
+}
+
+template<class Key, class Value, template<class> class Policy>
+void CapacityCache<Key, Value, Policy>::recordAccess(Entry &entry) {
+    std::uint64_t distance = m_accessCount - entry.lastAccess;
+    unsigned bucket = 64 - __builtin_clzll(distance | 1);
+    if (bucket >= CacheStats::REUSE_DISTANCE_BUCKETS)
+        bucket = CacheStats::REUSE_DISTANCE_BUCKETS - 1;
+    AskUser::State::increment(m_stats->reuseDistance[bucket]);
+    entry.lastAccess = m_accessCount;
+}
+
+/*
+ * Expired and invalidated entries are removed lazily on lookup. Entries never looked up again
+ * are found by walking few entries of the map on every update, starting where previous walk
+ * stopped.
+ */
+template<class Key, class Value, template<class> class Policy>
+void CapacityCache<Key, Value, Policy>::sweep(void) {
+    if (!m_expiringCount && !m_invalidated)
+        return;
+    if (m_keyValue.empty())
+        return;
+
+    auto it = m_sweepCursorValid ? m_keyValue.find(m_sweepCursor) : m_keyValue.end();
+    if (it == m_keyValue.end())
+        it = m_keyValue.begin();
+
+    auto now = Clock::now();
+    for (std::size_t i = 0; i < CACHE_SWEEP_ENTRIES && it != m_keyValue.end(); ++i) {
+        const Entry &entry = it->second;
+        if (!isValid(it->first, entry)) {
+            it = erase(it);
+        } else if (isExpiring(entry) && entry.expiry <= now) {
+            AskUser::State::increment(m_stats->expirations);
+            it = erase(it);
+        } else {
+            ++it;
+        }
     }
 
-    std::string cacheKey = m_keyHasher(key);
+    m_sweepCursorValid = it != m_keyValue.end();
+    if (m_sweepCursorValid)
+        m_sweepCursor = it->first;
+}
+
+template<class Key, class Value, template<class> class Policy>
+bool CapacityCache<Key, Value, Policy>::update(const Key &key, const Value &value,
+                                               Clock::duration ttl) {
+    std::size_t bytes = entryBytes(value);
+    if (!fits(1, bytes)) {
+        LOGD("Entry of [" << bytes << "] bytes does not fit in cache");
+        return false;
+    }
+    sweep();
+    ++m_accessCount;
 
     bool existed = false;
-    auto resultIt = m_keyValue.find(cacheKey);
+    auto resultIt = m_keyValue.find(key);
+    if (resultIt != m_keyValue.end() && !isValid(key, resultIt->second)) {
+        erase(resultIt);
+        resultIt = m_keyValue.end();
+    }
     if (resultIt != m_keyValue.end()) {
         existed = true;
-        auto usageIt = resultIt->second.second;
-        m_keyUsage.splice(m_keyUsage.begin(), m_keyUsage, usageIt);
+        if (isExpiring(resultIt->second))
+            --m_expiringCount;
+        AskUser::State::increment(m_stats->updates);
+        recordAccess(resultIt->second);
+        if (!resultIt->second.partition)
+            m_policy.touch(resultIt->second.handle);
+        else if (resultIt->second.inQuota)
+            resultIt->second.partition->policy.touch(resultIt->second.handle);
+        else
+            promote(key, resultIt->second);
         LOGD("Update existing entry key=<" << key << ">" << " with value=<" << value << ">");
+        m_bytes -= resultIt->second.bytes;
     } else {
-        m_keyUsage.push_front(cacheKey);
+        Partition *owner = isPartitioned() ? &partitionOf(key[m_partitionComponent]) : nullptr;
+        // Entry of partition without quota goes directly to overflow
+        if (owner && !owner->quota) {
+            if (!m_overflowLimit) {
+                LOGD("Entry does not fit in partition without quota nor in overflow");
+                return false;
+            }
+            while (m_overflowSize >= m_overflowLimit)
+                evict();
+        }
+        while (!fits(m_keyValue.size() + 1, m_bytes + bytes)) {
+            LOGD("Capacity [" << m_capacity << "] or budget [" << m_budget << "] reached");
+            if (!evict(owner)) {
+                LOGD("Entry does not fit without evicting entries of other partitions");
+                return false;
+            }
+        }
         LOGD("Added new entry key=<" << key << ">" << " and value=<" << value << ">");
+        resultIt = m_keyValue.insert(std::make_pair(key, Entry())).first;
+        // Entry must be valid before anything is evicted, otherwise it would be discarded
+        resultIt->second.generation = m_generation;
+        insertInto(owner, key, resultIt->second);
+        // Only entry demoted to make room for the new one may exceed limit of overflow
+        if (resultIt->second.inQuota)
+            trimOverflow();
+        resultIt->second.lastAccess = m_accessCount;
+        AskUser::State::increment(m_stats->insertions);
     }
 
-    m_keyValue[cacheKey] = std::make_pair(value, m_keyUsage.begin());
+    Entry &entry = resultIt->second;
+    entry.value = value;
+    entry.bytes = bytes;
+    entry.generation = m_generation;
+    if (ttl == Clock::duration::zero()) {
+        entry.expiry = Clock::time_point::max();
+    } else {
+        entry.expiry = Clock::now() + ttl;
+        ++m_expiringCount;
+    }
+    m_bytes += bytes;
+    publishSize();
+    // Updated value may be larger than the previous one. Entry is complete, so it may be
+    // evicted as well and must not be used afterwards.
+    if (existed)
+        shrink(entry.partition);
     return existed;
 }
 
@@ -0,0 +1,248 @@
+/*
+ *  Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/**
+ * @file        EvictionPolicy.h
+ * @author      Zofia Abramowska <z.abramowska@samsung.com>
+ * @brief       Eviction policies of CapacityCache.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "KeyHash.h"
+
+namespace Plugin {
+
+/*
+ * Eviction policy tracks keys stored in CapacityCache and chooses which one should be evicted.
+ * Every policy provides:
+ *     Handle insert(const CacheKey &key)  - new key was stored in cache
+ *     void touch(Handle &handle)          - stored key was used
+ *     void erase(Handle handle)           - key was removed from cache
+ *     void evict(Handle handle)           - key was removed from cache to make room for others
+ *     const CacheKey &victim()            - key which should be evicted next
+ *     void clear()                        - all keys were removed from cache
+ * and KEY_BYTES constant, the number of bytes policy needs to track a single key.
+ */
+
+// Evicts least recently used key
+template<class CacheKey>
+class LRUPolicy {
+public:
+    typedef typename std::list<CacheKey>::iterator Handle;
+
+    // List node with two pointers
+    static const std::size_t KEY_BYTES = sizeof(CacheKey) + 2 * sizeof(void *);
+
+    Handle insert(const CacheKey &key) {
+        m_usage.push_front(key);
+        return m_usage.begin();
+    }
+
+    void touch(Handle &handle) {
+        m_usage.splice(m_usage.begin(), m_usage, handle);
+    }
+
+    void erase(Handle handle) {
+        m_usage.erase(handle);
+    }
+
+    void evict(Handle handle) {
+        erase(handle);
+    }
+
+    const CacheKey &victim() {
+        return m_usage.back();
+    }
+
+    void clear() {
+        m_usage.clear();
+    }
+
+private:
+    std::list<CacheKey> m_usage;
+};
+
+/*
+ * Approximates LRU with a single reference bit per key. Use of key only sets the bit in a slot
+ * of contiguous array, victim is found by clock hand sweeping over slots.
+ */
+template<class CacheKey>
+class ClockPolicy {
+    struct Slot {
+        CacheKey key;
+        bool used;
+        bool referenced;
+    };
+
+public:
+    typedef std::size_t Handle;
+
+    // Slot in array and its index on free list once key is erased
+    static const std::size_t KEY_BYTES = sizeof(Slot) + sizeof(Handle);
+
+    ClockPolicy() : m_hand(0) {}
+
+    Handle insert(const CacheKey &key) {
+        Handle handle;
+        if (m_free.empty()) {
+            handle = m_slots.size();
+            m_slots.push_back(Slot());
+        } else {
+            handle = m_free.back();
+            m_free.pop_back();
+        }
+        m_slots[handle].key = key;
+        m_slots[handle].used = true;
+        m_slots[handle].referenced = false;
+        return handle;
+    }
+
+    void touch(Handle &handle) {
+        m_slots[handle].referenced = true;
+    }
+
+    void erase(Handle handle) {
+        m_slots[handle].used = false;
+        m_free.push_back(handle);
+    }
+
+    void evict(Handle handle) {
+        erase(handle);
+    }
+
+    const CacheKey &victim() {
+        while (true) {
+            m_hand = (m_hand + 1) % m_slots.size();
+            Slot &slot = m_slots[m_hand];
+            if (!slot.used)
+                continue;
+            if (!slot.referenced)
+                return slot.key;
+            slot.referenced = false;
+        }
+    }
+
+    void clear() {
+        m_slots.clear();
+        m_free.clear();
+        m_hand = 0;
+    }
+
+private:
+    std::vector<Slot> m_slots;
+    std::vector<Handle> m_free;
+    std::size_t m_hand;
+};
+
+/*
+ * Simplified 2Q. New keys enter FIFO queue and are promoted to LRU queue only when they are
+ * inserted again shortly after being evicted (remembered in ghost queue). Keys used only once,
+ * e.g. during scans, are evicted from FIFO queue without pushing out frequently used keys.
+ */
+template<class CacheKey>
+class TwoQueuePolicy {
+public:
+    // Share of FIFO queue in all stored keys is kept at most 1 / IN_QUEUE_RATIO
+    static const std::size_t IN_QUEUE_RATIO = 4;
+    // Ghost queue remembers at most half as many keys as are stored
+    static const std::size_t GHOST_QUEUE_RATIO = 2;
+
+    struct Handle {
+        bool frequent;
+        typename std::list<CacheKey>::iterator it;
+    };
+
+    // List node and share of ghost queue, which remembers keys in list and map
+    static const std::size_t KEY_BYTES = sizeof(CacheKey) + 2 * sizeof(void *)
+        + (2 * sizeof(CacheKey) + 5 * sizeof(void *) + sizeof(std::size_t)) / GHOST_QUEUE_RATIO;
+
+    Handle insert(const CacheKey &key) {
+        Handle handle;
+        auto ghostIt = m_ghostKeys.find(key);
+        if (ghostIt != m_ghostKeys.end()) {
+            m_ghost.erase(ghostIt->second);
+            m_ghostKeys.erase(ghostIt);
+            m_frequent.push_front(key);
+            handle.frequent = true;
+            handle.it = m_frequent.begin();
+        } else {
+            m_recent.push_front(key);
+            handle.frequent = false;
+            handle.it = m_recent.begin();
+        }
+        return handle;
+    }
+
+    void touch(Handle &handle) {
+        // Use of key in FIFO queue does not change its position
+        if (handle.frequent)
+            m_frequent.splice(m_frequent.begin(), m_frequent, handle.it);
+    }
+
+    void erase(Handle handle) {
+        if (handle.frequent)
+            m_frequent.erase(handle.it);
+        else
+            m_recent.erase(handle.it);
+    }
+
+    // Only keys pushed out of FIFO queue are remembered, not expired or invalidated ones
+    void evict(Handle handle) {
+        if (!handle.frequent)
+            remember(*handle.it);
+        erase(handle);
+    }
+
+    const CacheKey &victim() {
+        std::size_t size = m_recent.size() + m_frequent.size();
+        if (!m_recent.empty() && (m_frequent.empty() || m_recent.size() * IN_QUEUE_RATIO > size))
+            return m_recent.back();
+        return m_frequent.back();
+    }
+
+    void clear() {
+        m_recent.clear();
+        m_frequent.clear();
+        m_ghost.clear();
+        m_ghostKeys.clear();
+    }
+
+private:
+    std::list<CacheKey> m_recent;
+    std::list<CacheKey> m_frequent;
+    std::list<CacheKey> m_ghost;
+    std::unordered_map<CacheKey, typename std::list<CacheKey>::iterator,
+                       KeyHash<CacheKey>> m_ghostKeys;
+
+    void remember(const CacheKey &key) {
+        if (m_ghostKeys.count(key))
+            return;
+        m_ghost.push_front(key);
+        m_ghostKeys[key] = m_ghost.begin();
+        std::size_t limit = (m_recent.size() + m_frequent.size()) / GHOST_QUEUE_RATIO;
+        while (m_ghost.size() > limit) {
+            m_ghostKeys.erase(m_ghost.back());
+            m_ghost.pop_back();
+        }
+    }
+};
+
+} // namespace Plugin
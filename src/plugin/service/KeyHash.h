@@ -0,0 +1,44 @@
+/*
+ *  Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/**
+ * @file        KeyHash.h
+ * @author      Zofia Abramowska <z.abramowska@samsung.com>
+ * @brief       Hash functor for keys of CapacityCache.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <functional>
+
+namespace Plugin {
+
+template<class T>
+struct KeyHash : std::hash<T> {};
+
+// Combines hashes of all components, like boost::hash_combine does
+template<class T, std::size_t N>
+struct KeyHash<std::array<T, N>> {
+    std::size_t operator()(const std::array<T, N> &key) const {
+        std::size_t seed = 0;
+        for (const auto &component : key)
+            seed ^= std::hash<T>()(component) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        return seed;
+    }
+};
+
+} // namespace Plugin
@@ -0,0 +1,211 @@
+/*
+ *  Copyright (c) 2015 Samsung Electronics Co.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/**
+ * @file        PluginConfig.cpp
+ * @author      Zofia Abramowska <z.abramowska@samsung.com>
+ * @brief       Implementation of service plugin configuration
+ */
+
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <sys/stat.h>
+#include <unordered_set>
+
+#include <log/log.h>
+
+#include "PluginConfig.h"
+
+namespace Plugin {
+
+namespace {
+
+const std::size_t noUserOverflow = std::numeric_limits<std::size_t>::max();
+
+bool parseBytes(std::istream &stream, std::size_t &bytes) {
+    unsigned long long value;
+    if (!(stream >> value))
+        return false;
+
+    std::string suffix;
+    stream >> suffix;
+    if (suffix == "K")
+        value <<= 10;
+    else if (suffix == "M")
+        value <<= 20;
+    else if (!suffix.empty())
+        return false;
+
+    bytes = static_cast<std::size_t>(value);
+    return true;
+}
+
+} // namespace
+
+PluginConfig::PluginConfig(const std::string &path)
+    : m_path(path),
+      m_defaultTtl(std::chrono::seconds::zero()),
+      m_cacheBudget(0),
+      m_cacheFloor(0),
+      m_defaultUserQuota(0),
+      m_userOverflow(noUserOverflow)
+{
+    m_mtime.tv_sec = 0;
+    m_mtime.tv_nsec = 0;
+    reloadIfChanged();
+}
+
+bool PluginConfig::reloadIfChanged() {
+    struct stat st;
+    if (stat(m_path.c_str(), &st) < 0) {
+        if (m_mtime.tv_sec || m_mtime.tv_nsec) {
+            LOGD("Configuration file <" << m_path << "> removed, using defaults");
+            reset();
+            m_mtime.tv_sec = 0;
+            m_mtime.tv_nsec = 0;
+        }
+        return false;
+    }
+
+    if (st.st_mtim.tv_sec == m_mtime.tv_sec && st.st_mtim.tv_nsec == m_mtime.tv_nsec)
+        return false;
+
+    m_mtime = st.st_mtim;
+    return load();
+}
+
+void PluginConfig::reset() {
+    m_defaultTtl = std::chrono::seconds::zero();
+    m_privilegeTtl.clear();
+    m_cacheBudget = 0;
+    m_cacheFloor = 0;
+    m_defaultUserQuota = 0;
+    m_userQuota.clear();
+    m_userOverflow = noUserOverflow;
+    m_privilegeGroups.clear();
+}
+
+std::chrono::seconds PluginConfig::ttl(const std::string &privilege) const {
+    auto it = m_privilegeTtl.find(privilege);
+    if (it != m_privilegeTtl.end())
+        return it->second;
+    return m_defaultTtl;
+}
+
+bool PluginConfig::load() {
+    std::ifstream file(m_path);
+    if (!file.is_open()) {
+        LOGD("No configuration file <" << m_path << ">, using defaults");
+        return false;
+    }
+
+    std::chrono::seconds defaultTtl(std::chrono::seconds::zero());
+    std::unordered_map<std::string, std::chrono::seconds> privilegeTtl;
+    std::size_t cacheBudget = 0;
+    std::size_t cacheFloor = 0;
+    std::size_t defaultUserQuota = 0;
+    std::unordered_map<std::string, std::size_t> userQuota;
+    std::size_t userOverflow = noUserOverflow;
+    std::vector<std::vector<std::string>> privilegeGroups;
+    std::unordered_set<std::string> groupedPrivileges;
+
+    std::string line;
+    unsigned lineNo = 0;
+    while (std::getline(file, line)) {
+        ++lineNo;
+        std::istringstream stream(line);
+        std::string option;
+        if (!(stream >> option) || option[0] == '#')
+            continue;
+
+        if (option == "ttl") {
+            std::string privilege;
+            long long seconds;
+            if (!(stream >> privilege >> seconds) || seconds < 0) {
+                LOGE("Invalid ttl option in line " << lineNo << " of <" << m_path << ">");
+                return false;
+            }
+            if (privilege == "*")
+                defaultTtl = std::chrono::seconds(seconds);
+            else
+                privilegeTtl[privilege] = std::chrono::seconds(seconds);
+        } else if (option == "cache_budget") {
+            if (!parseBytes(stream, cacheBudget)) {
+                LOGE("Invalid cache_budget option in line " << lineNo << " of <" << m_path
+                     << ">");
+                return false;
+            }
+        } else if (option == "cache_floor") {
+            if (!parseBytes(stream, cacheFloor)) {
+                LOGE("Invalid cache_floor option in line " << lineNo << " of <" << m_path
+                     << ">");
+                return false;
+            }
+        } else if (option == "user_quota") {
+            std::string user;
+            long long entries;
+            if (!(stream >> user >> entries) || entries < 0) {
+                LOGE("Invalid user_quota option in line " << lineNo << " of <" << m_path << ">");
+                return false;
+            }
+            if (user == "*")
+                defaultUserQuota = static_cast<std::size_t>(entries);
+            else
+                userQuota[user] = static_cast<std::size_t>(entries);
+        } else if (option == "user_overflow") {
+            long long entries;
+            if (!(stream >> entries) || entries < 0) {
+                LOGE("Invalid user_overflow option in line " << lineNo << " of <" << m_path
+                     << ">");
+                return false;
+            }
+            userOverflow = static_cast<std::size_t>(entries);
+        } else if (option == "privilege_group") {
+            std::vector<std::string> group;
+            std::string privilege;
+            while (stream >> privilege) {
+                if (!groupedPrivileges.insert(privilege).second) {
+                    LOGE("Privilege <" << privilege << "> is already in a group, line "
+                         << lineNo << " of <" << m_path << ">");
+                    return false;
+                }
+                group.push_back(privilege);
+            }
+            if (group.size() < 2) {
+                LOGE("Invalid privilege_group option in line " << lineNo << " of <" << m_path
+                     << ">");
+                return false;
+            }
+            privilegeGroups.push_back(std::move(group));
+        } else {
+            LOGE("Unknown option <" << option << "> in line " << lineNo << " of <" << m_path
+                 << ">");
+            return false;
+        }
+    }
+
+    m_defaultTtl = defaultTtl;
+    m_privilegeTtl.swap(privilegeTtl);
+    m_cacheBudget = cacheBudget;
+    m_cacheFloor = cacheFloor;
+    m_defaultUserQuota = defaultUserQuota;
+    m_userQuota.swap(userQuota);
+    m_userOverflow = userOverflow;
+    m_privilegeGroups.swap(privilegeGroups);
+    return true;
+}
+
+} // namespace Plugin
@@ -0,0 +1,108 @@
+/*
+ *  Copyright (c) 2015 Samsung Electronics Co.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/**
+ * @file        PluginConfig.h
+ * @author      Zofia Abramowska <z.abramowska@samsung.com>
+ * @brief       Declaration of service plugin configuration
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <ctime>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Plugin {
+
+/*
+ * Configuration file contains one option per line. Empty lines and lines starting with '#'
+ * are ignored. Supported options:
+ *     ttl <privilege|*> <seconds>  - lifetime of cached decisions, 0 means no limit
+ *     cache_budget <bytes>[K|M]     - estimated memory available for cached decisions and
+ *                                     identifiers interned for them, which are never released;
+ *                                     without this option cache is limited only by number of
+ *                                     entries
+ *     cache_floor <bytes>[K|M]      - memory left to cache under memory pressure, by default
+ *                                     a quarter of memory taken when pressure started
+ *     user_quota <user|*> <entries> - decisions of user kept in his own partition of cache,
+ *                                     '*' sets quota of users not listed, which is 0 (all
+ *                                     their decisions go to overflow) unless set; cache is
+ *                                     partitioned by user once any quota is configured
+ *     user_overflow <entries>       - limit of decisions beyond quotas, shared by all users;
+ *                                     older decisions of user over his quota move there and
+ *                                     are evicted first, without this option it is limited
+ *                                     only by size of cache
+ *     privilege_group <privilege> <privilege>...
+ *                                   - at least two privileges, each in at most one group;
+ *                                     lifetime decision about one of them is cached for all
+ *                                     of them, with ttl of each privilege
+ */
+class PluginConfig {
+public:
+    PluginConfig(const std::string &path);
+
+    // Returns true if file was modified and loaded successfully
+    bool reloadIfChanged();
+
+    std::chrono::seconds ttl(const std::string &privilege) const;
+    // 0 if no budget was configured
+    std::size_t cacheBudget() const {
+        return m_cacheBudget;
+    }
+    // 0 if no floor was configured
+    std::size_t cacheFloor() const {
+        return m_cacheFloor;
+    }
+    // Cache is partitioned by user once quota of any user is configured
+    bool userPartitions() const {
+        return m_defaultUserQuota || !m_userQuota.empty();
+    }
+    // Quota of users without their own one, 0 if not configured
+    std::size_t defaultUserQuota() const {
+        return m_defaultUserQuota;
+    }
+    const std::unordered_map<std::string, std::size_t> &userQuotas() const {
+        return m_userQuota;
+    }
+    // Limit of entries beyond quotas of users, SIZE_MAX if not configured
+    std::size_t userOverflow() const {
+        return m_userOverflow;
+    }
+    // Privileges of one group share lifetime decisions
+    const std::vector<std::vector<std::string>> &privilegeGroups() const {
+        return m_privilegeGroups;
+    }
+
+private:
+    std::string m_path;
+    struct timespec m_mtime;
+    std::chrono::seconds m_defaultTtl;
+    std::unordered_map<std::string, std::chrono::seconds> m_privilegeTtl;
+    std::size_t m_cacheBudget;
+    std::size_t m_cacheFloor;
+    std::size_t m_defaultUserQuota;
+    std::unordered_map<std::string, std::size_t> m_userQuota;
+    std::size_t m_userOverflow;
+    std::vector<std::vector<std::string>> m_privilegeGroups;
+
+    bool load();
+    void reset();
+};
+
+} // namespace Plugin
@@ -0,0 +1,85 @@
+/*
+ *  Copyright (c) 2015 Samsung Electronics Co.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/**
+ * @file        PrivilegeGroups.h
+ * @author      Zofia Abramowska <z.abramowska@samsung.com>
+ * @brief       Groups of privileges sharing lifetime decisions
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <intern/InternTable.h>
+
+namespace Plugin {
+
+/*
+ * Interned privileges are dense small ids, so group of privilege is found by indexing array.
+ * Members of all groups are stored one after another, group is a range of them.
+ */
+class PrivilegeGroups {
+public:
+    typedef AskUser::Intern::Id Id;
+
+    PrivilegeGroups() : m_offsets(1, 0) {}
+
+    // Privilege may belong to one group only
+    void assign(const std::vector<std::vector<std::string>> &groups) {
+        m_groupOf.clear();
+        m_offsets.assign(1, 0);
+        m_members.clear();
+        for (const auto &group : groups) {
+            std::uint32_t index = static_cast<std::uint32_t>(m_offsets.size());
+            for (const auto &privilege : group) {
+                Id id = AskUser::Intern::intern(privilege);
+                // New elements are 0, i.e. NO_GROUP
+                if (id >= m_groupOf.size())
+                    m_groupOf.resize(id + 1);
+                m_groupOf[id] = index;
+                m_members.push_back(id);
+            }
+            m_offsets.push_back(static_cast<std::uint32_t>(m_members.size()));
+        }
+        m_groupOf.shrink_to_fit();
+        m_members.shrink_to_fit();
+    }
+
+    // Calls function for every other member of group of privilege
+    template<class Function>
+    void forEachSibling(Id privilege, Function function) const {
+        if (privilege >= m_groupOf.size() || m_groupOf[privilege] == NO_GROUP)
+            return;
+        std::uint32_t index = m_groupOf[privilege];
+        for (std::uint32_t i = m_offsets[index - 1]; i < m_offsets[index]; ++i) {
+            if (m_members[i] != privilege)
+                function(m_members[i]);
+        }
+    }
+
+private:
+    static const std::uint32_t NO_GROUP = 0;
+
+    // Index of group (from 1) by privilege id
+    std::vector<std::uint32_t> m_groupOf;
+    // Members of group i are m_members[m_offsets[i - 1]] to m_members[m_offsets[i] - 1]
+    std::vector<std::uint32_t> m_offsets;
+    std::vector<Id> m_members;
+};
+
+} // namespace Plugin
@@ -19,25 +19,43 @@
  * @brief       Implementation of cynara server side AskUser plugin.
  */
 
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <map>
 #include <string>
-#include <tuple>
+#include <vector>
 #include <iostream>
 #include <ostream>
 #include <cynara-plugin.h>
 
+#include <intern/InternTable.h>
+#include <pressure/MemoryPressure.h>
+#include <state/PluginState.h>
+#include <trace/SpanRing.h>
 #include <types/PolicyDescription.h>
 #include <types/SupportedTypes.h>
 #include <translator/Translator.h>
 
 #include "CapacityCache.h"
+#include "PluginConfig.h"
+#include "PrivilegeGroups.h"
 
 using namespace Cynara;
 
-typedef std::tuple<std::string, std::string, std::string> Key;
+// Interned client, user and privilege
+typedef std::array<AskUser::Intern::Id, 3> Key;
+enum KeyComponent : std::size_t {
+    CLIENT,
+    USER,
+    PRIVILEGE
+};
+
 std::ostream &operator<<(std::ostream &os, const Key &key) {
-    os << "client: " << std::get<0>(key)
-       << ", user: " << std::get<1>(key)
-       << ", privilege: " << std::get<2>(key);
+    os << "client: " << AskUser::Intern::value(key[CLIENT])
+       << ", user: " << AskUser::Intern::value(key[USER])
+       << ", privilege: " << AskUser::Intern::value(key[PRIVILEGE]);
     return os;
 }
 
@@ -47,19 +65,32 @@ std::ostream &operator<<(std::ostream &os, const PolicyResult &result) {
     return os;
 }
 
-namespace AskUser {
+namespace Plugin {
 
-std::function<std::string(const Key&)> hasher = [](const Key &key) {
-    const char separator = '\1';
-    const auto &client = std::get<0>(key);
-    const auto &user = std::get<1>(key);
-    const auto &privilege = std::get<2>(key);
-    return client + user + privilege + separator +
-            std::to_string(client.size()) + separator +
-            std::to_string(user.size()) + separator +
-            std::to_string(privilege.size());
+// Only metadata which does not fit in capacity of empty string is allocated on heap
+template<>
+struct ValueBytes<PolicyResult> {
+    std::size_t operator()(const PolicyResult &result) const {
+        static const std::size_t inlineCapacity = std::string().capacity();
+        std::size_t capacity = result.metadata().capacity();
+        return capacity > inlineCapacity ? capacity + 1 : 0;
+    }
 };
 
+} // namespace Plugin
+
+namespace AskUser {
+
+#if defined(CACHE_POLICY_CLOCK)
+typedef Plugin::CapacityCache<Key, PolicyResult, Plugin::ClockPolicy> Cache;
+#elif defined(CACHE_POLICY_2Q)
+typedef Plugin::CapacityCache<Key, PolicyResult, Plugin::TwoQueuePolicy> Cache;
+#else
+typedef Plugin::CapacityCache<Key, PolicyResult, Plugin::LRUPolicy> Cache;
+#endif
+
+const char *const configPath = ASKUSER_CONF_DIR "/plugin-service.conf";
+
 const std::vector<PolicyDescription> serviceDescriptions = {
     { SupportedTypes::Service::ASK_USER, "Ask user" }
 };
@@ -67,8 +98,40 @@ const std::vector<PolicyDescription> serviceDescriptions = {
 class AskUserPlugin : public ServicePluginInterface {
 public:
     AskUserPlugin()
-        : m_cache(hasher)
-    {}
+        : m_config(configPath),
+          m_pressureFloor(0),
+          m_internBytes(0),
+          m_epochValue(0),
+          m_state(State::mapPluginState(true)),
+          m_partitionState(State::mapPartitionState(true)),
+          m_spans(Trace::mapSpanRing("plugin", true))
+    {
+        if (!m_state) {
+            LOGE("Unable to map shared plugin state. Lifetime decisions won't be cached by clients");
+        } else {
+            // Decisions cached by clients before restart of service are no longer valid
+            m_state->epoch.fetch_add(1);
+            m_cache.bindStats(m_state->cache);
+        }
+        if (!m_partitionState) {
+            LOGE("Unable to map shared partition state. "
+                 "Statistics of partitions won't be exported");
+        } else {
+            // Partitions of previous instance of plugin are gone together with its cache
+            releasePartitionSlots();
+            m_cache.bindPartitionStats([this](const Intern::Id &user) {
+                return bindPartitionSlot(user);
+            });
+        }
+        applyConfig();
+    }
+
+    ~AskUserPlugin() {
+        Trace::unmapSpanRing(m_spans);
+        State::unmapPartitionState(m_partitionState);
+        State::unmapPluginState(m_state);
+    }
+
     const std::vector<PolicyDescription> &getSupportedPolicyDescr() {
         return serviceDescriptions;
     }
@@ -81,15 +144,18 @@ public:
                        PluginData &pluginData) noexcept
     {
         try {
-            if (!m_cache.get(Key(client, user, privilege), result)) {
-                pluginData = Translator::Plugin::requestToData(client, user, privilege);
+            Trace::Timestamp start = Trace::now();
+            Key key;
+            // Identifiers are interned only once decision about them is cached
+            if (!findKey(client, user, privilege, key) || !m_cache.get(key, result)) {
+                Trace::CorrelationId correlationId = Trace::newCorrelationId();
+                pluginData = Translator::Plugin::requestToData(client, user, privilege,
+                                                               correlationId);
                 requiredAgent = AgentType(SupportedTypes::Agent::AgentType);
+                traceCheck(client, user, privilege, correlationId, start);
                 return PluginStatus::ANSWER_NOTREADY;
             }
-            if (result.policyType() == SupportedTypes::Client::ALLOW_PER_LIFE)
-                result = PolicyResult(PredefinedPolicyType::ALLOW);
-            else
-                result = PolicyResult(PredefinedPolicyType::DENY);
+            attachEpoch(result);
             return PluginStatus::ANSWER_READY;
         } catch (const Translator::TranslateErrorException &e) {
             LOGE("Error translating request to data : " << e.what());
@@ -101,6 +167,49 @@ public:
         return PluginStatus::ERROR;
     }
 
+    /*
+     * Client, user and all privileges are looked up in intern table at once, without interning
+     * them. Privileges without cached decision are only reported, their requests are made by
+     * regular check().
+     */
+    bool checkPrivileges(const char *client, const char *user, const char *const *privileges,
+                         std::size_t count, PolicyType *types, std::uint32_t *misses,
+                         std::size_t &missCount, std::uint64_t &epoch) noexcept
+    {
+        try {
+            // Strings and ids are reused, so launches of applications do not allocate
+            m_bulkValues.resize(count + 2);
+            m_bulkValues[0].assign(client);
+            m_bulkValues[1].assign(user);
+            for (std::size_t i = 0; i < count; ++i)
+                m_bulkValues[i + 2].assign(privileges[i]);
+            m_bulkLookup.clear();
+            for (const auto &value : m_bulkValues)
+                m_bulkLookup.push_back(&value);
+            Intern::table().find(m_bulkLookup, m_bulkIds);
+
+            Key key{{m_bulkIds[0], m_bulkIds[1], 0}};
+            bool known = key[CLIENT] != Intern::NO_ID && key[USER] != Intern::NO_ID;
+            PolicyResult result;
+            missCount = 0;
+            for (std::size_t i = 0; i < count; ++i) {
+                key[PRIVILEGE] = m_bulkIds[i + 2];
+                if (!known || key[PRIVILEGE] == Intern::NO_ID || !m_cache.get(key, result)) {
+                    misses[missCount++] = static_cast<std::uint32_t>(i);
+                    continue;
+                }
+                types[i] = result.policyType();
+            }
+            epoch = m_state ? m_state->epoch.load() : 0;
+            return true;
+        } catch (const std::exception &e) {
+            LOGE("Failed with std exception: " << e.what());
+        } catch (...) {
+            LOGE("Failed with unknown exception: ");
+        }
+        return false;
+    }
+
     PluginStatus update(const std::string &client,
                         const std::string &user,
                         const std::string &privilege,
@@ -108,17 +217,27 @@ public:
                         PolicyResult &result) noexcept
     {
         try {
+            Trace::Timestamp start = Trace::now();
+            if (m_config.reloadIfChanged())
+                applyConfig();
+            watchPressure();
+
             PolicyType resultType = Translator::Plugin::dataToAnswer(agentData);
             result = PolicyResult(resultType);
 
-            if (resultType == SupportedTypes::Client::ALLOW_PER_LIFE) {
-                m_cache.update(Key(client, user, privilege), PolicyResult(resultType));
-                result = PolicyResult(PredefinedPolicyType::ALLOW);
-            } else if (resultType == SupportedTypes::Client::DENY_PER_LIFE) {
-                m_cache.update(Key(client, user, privilege), PolicyResult(resultType));
-                result = PolicyResult(PredefinedPolicyType::DENY);
+            if (resultType == SupportedTypes::Client::ALLOW_PER_LIFE
+                    || resultType == SupportedTypes::Client::DENY_PER_LIFE) {
+                Key key = internKey(client, user, privilege);
+                if (Intern::table().bytes() != m_internBytes)
+                    chargeInternTable();
+                result = cachedResult(resultType, privilege);
+                m_cache.update(key, result, m_config.ttl(privilege));
+                expandToGroup(key, resultType);
+                attachEpoch(result);
             }
 
+            if (m_spans)
+                traceUpdate(client, user, privilege, start);
             return PluginStatus::SUCCESS;
         } catch (const Translator::TranslateErrorException &e) {
             LOGE("Error translating data to answer : " << e.what());
@@ -131,13 +250,267 @@ public:
     }
 
     void invalidate() {
+        if (m_config.reloadIfChanged())
+            applyConfig();
         m_cache.clear();
+        bumpEpoch();
+    }
+
+    // Drops only decisions concerning given client, user or privilege
+    void invalidate(KeyComponent component, const std::string &value) {
+        Intern::Id id;
+        // Value which was never interned cannot be part of any cached key
+        if (Intern::table().find(value, id))
+            m_cache.invalidate(component, id);
+        bumpEpoch();
     }
 
 private:
-    Plugin::CapacityCache<Key, PolicyResult> m_cache;
+    Plugin::PluginConfig m_config;
+    Plugin::PrivilegeGroups m_groups;
+    Cache m_cache;
+    Pressure::MemoryPressure m_pressure;
+    // Budget of cache while memory pressure lasts, 0 otherwise
+    std::size_t m_pressureFloor;
+    // Part of budget taken by intern table when budget of cache was last set
+    std::size_t m_internBytes;
+    // Epoch passed to clients, formatted again only once it changes
+    std::uint64_t m_epochValue;
+    std::string m_epoch;
+    State::PluginState *m_state;
+    State::PartitionState *m_partitionState;
+    Trace::SpanRing *m_spans;
+
+    // Requests sent to agent, cynara gives their answers to update() by client, user and privilege
+    struct PendingTrace {
+        Trace::CorrelationId correlationId;
+        Trace::Timestamp sent;
+    };
+    static const std::size_t MAX_PENDING_TRACES = 1024;
+    // Client, user and privilege, which may be not interned
+    typedef std::array<std::string, 3> TraceKey;
+    std::map<TraceKey, PendingTrace> m_pendingTraces;
+
+    // Reused by checkPrivileges()
+    std::vector<std::string> m_bulkValues;
+    std::vector<const std::string *> m_bulkLookup;
+    std::vector<Intern::Id> m_bulkIds;
+
+    static Key internKey(const std::string &client, const std::string &user,
+                         const std::string &privilege) {
+        return Key{{Intern::intern(client), Intern::intern(user), Intern::intern(privilege)}};
+    }
+
+    // Identifier which was never interned cannot be part of any cached key
+    static bool findKey(const std::string &client, const std::string &user,
+                        const std::string &privilege, Key &key) {
+        const auto &table = Intern::table();
+        return table.find(client, key[CLIENT]) && table.find(user, key[USER])
+               && table.find(privilege, key[PRIVILEGE]);
+    }
+
+    // Configured budget replaces default limit of entries
+    void applyCacheLimits() {
+        std::size_t budget = m_pressureFloor ? m_pressureFloor : m_config.cacheBudget();
+        if (budget) {
+            LOGD("Cache limited to [" << budget << "] bytes");
+            m_cache.setCapacity(std::numeric_limits<std::size_t>::max());
+            m_cache.setBudget(budget);
+            m_internBytes = 0;
+            chargeInternTable();
+        } else {
+            m_cache.setBudget(Cache::CACHE_NO_BUDGET);
+            m_cache.setCapacity(Cache::CACHE_DEFAULT_CAPACITY);
+        }
+    }
+
+    /*
+     * Identifiers of cached keys are never released, so intern table takes its part of budget
+     * and cache gets the rest. Once the table alone exceeds budget, decisions are not cached.
+     * Floor under memory pressure is left to cache alone, as the table cannot shrink anyway.
+     */
+    void chargeInternTable() {
+        std::size_t budget = m_config.cacheBudget();
+        std::size_t previous = m_internBytes;
+        m_internBytes = Intern::table().bytes();
+        if (!budget || m_pressureFloor)
+            return;
+        if (budget > m_internBytes) {
+            m_cache.setBudget(budget - m_internBytes);
+            return;
+        }
+        if (budget > previous)
+            LOGE("Intern table of [" << m_internBytes << "] bytes exceeds cache budget of ["
+                 << budget << "] bytes, decisions are not cached");
+        // Budget of 0 would mean no budget at all
+        m_cache.setBudget(1);
+    }
+
+    void applyConfig() {
+        applyCacheLimits();
+        applyPartitions();
+        m_groups.assign(m_config.privilegeGroups());
+    }
+
+    // Lifetime decision about one privilege of group is decision about all of them
+    void expandToGroup(Key key, PolicyType resultType) {
+        Intern::Id answered = key[PRIVILEGE];
+        m_groups.forEachSibling(answered, [&](Intern::Id privilege) {
+            key[PRIVILEGE] = privilege;
+            LOGD("Decision expanded to group: " << key);
+            const std::string &value = Intern::value(privilege);
+            m_cache.update(key, cachedResult(resultType, value), m_config.ttl(value));
+        });
+    }
+
+    /*
+     * Users with many applications would otherwise push decisions of other users out of cache
+     * and get them prompted again. Partition of every user keeps its quota of entries, only
+     * the rest competes for shared overflow.
+     */
+    void applyPartitions() {
+        if (!m_config.userPartitions()) {
+            m_cache.disablePartitioning();
+            releasePartitionSlots();
+            return;
+        }
+        m_cache.setPartitioning(USER, m_config.defaultUserQuota(), m_config.userOverflow());
+        m_cache.resetQuotas();
+        for (const auto &quota : m_config.userQuotas())
+            m_cache.setQuota(Intern::intern(quota.first), quota.second);
+    }
+
+    // Partitions of users beyond slots in shared state keep their statistics to themselves
+    State::PartitionStats *bindPartitionSlot(Intern::Id user) {
+        for (auto &slot : m_partitionState->partitions) {
+            if (slot.user[0])
+                continue;
+            State::resetPartitionStats(slot);
+            const std::string &name = Intern::value(user);
+            strncpy(slot.user, name.c_str(), sizeof(slot.user) - 1);
+            slot.user[sizeof(slot.user) - 1] = '\0';
+            return &slot;
+        }
+        return nullptr;
+    }
+
+    void releasePartitionSlots() {
+        if (!m_partitionState)
+            return;
+        for (auto &slot : m_partitionState->partitions)
+            State::resetPartitionStats(slot);
+    }
+
+    /*
+     * Under memory pressure cold entries are evicted down to the floor, so their memory can be
+     * reclaimed. Configured limits are restored once pressure ends. Pressure is polled only by
+     * update(), which waits for the agent anyway, so lookups never read the clock nor /proc.
+     */
+    void watchPressure() {
+        switch (m_pressure.poll()) {
+        case Pressure::MemoryPressure::Transition::Started:
+            m_pressureFloor = m_config.cacheFloor() ? m_config.cacheFloor() : m_cache.bytes() / 4;
+            if (m_config.cacheBudget() && m_config.cacheBudget() < m_pressureFloor)
+                m_pressureFloor = m_config.cacheBudget();
+            // Budget of 0 would mean no budget at all
+            if (!m_pressureFloor)
+                m_pressureFloor = 1;
+            LOGD("Memory pressure started, shrinking cache from [" << m_cache.bytes()
+                 << "] to [" << m_pressureFloor << "] bytes");
+            applyCacheLimits();
+            if (m_state)
+                State::increment(m_state->pressureShrinks);
+            break;
+        case Pressure::MemoryPressure::Transition::Ended:
+            LOGD("Memory pressure ended, restoring cache limits");
+            m_pressureFloor = 0;
+            applyCacheLimits();
+            if (m_state)
+                State::increment(m_state->pressureRestores);
+            break;
+        case Pressure::MemoryPressure::Transition::None:
+            break;
+        }
+    }
+
+    void traceCheck(const std::string &client, const std::string &user,
+                    const std::string &privilege, Trace::CorrelationId correlationId,
+                    Trace::Timestamp start) {
+        if (!m_spans)
+            return;
+        Trace::Timestamp end = Trace::now();
+        Trace::recordSpan(m_spans, "plugin.check", correlationId, start, end);
+        // Requests cancelled by cynara are never updated
+        if (m_pendingTraces.size() >= MAX_PENDING_TRACES)
+            m_pendingTraces.clear();
+        m_pendingTraces[TraceKey{{client, user, privilege}}] = PendingTrace{correlationId, end};
+    }
+
+    void traceUpdate(const std::string &client, const std::string &user,
+                     const std::string &privilege, Trace::Timestamp start) {
+        auto it = m_pendingTraces.find(TraceKey{{client, user, privilege}});
+        if (it == m_pendingTraces.end())
+            return;
+        Trace::recordSpan(m_spans, "plugin.wait", it->second.correlationId, it->second.sent,
+                          start);
+        Trace::recordSpan(m_spans, "plugin.update", it->second.correlationId, start,
+                          Trace::now());
+        m_pendingTraces.erase(it);
+    }
+
+    void bumpEpoch() {
+        if (m_state)
+            m_state->epoch.fetch_add(1);
+    }
+
+    /*
+     * Lifetime decision is cached as it is passed to client. Decision about privilege without
+     * ttl keeps its lifetime type and gets current epoch on every lookup, so client plugin can
+     * cache it until service plugin cache is invalidated. Expiry of decision does not change
+     * epoch, so decisions about privileges with ttl are cached as plain allow/deny, which
+     * clients do not cache. Without shared state clients get plain allow/deny.
+     */
+    PolicyResult cachedResult(PolicyType type, const std::string &privilege) const {
+        if (m_state && m_config.ttl(privilege) == std::chrono::seconds::zero())
+            return PolicyResult(type);
+        if (type == SupportedTypes::Client::ALLOW_PER_LIFE)
+            return PolicyResult(PredefinedPolicyType::ALLOW);
+        return PolicyResult(PredefinedPolicyType::DENY);
+    }
+
+    void attachEpoch(PolicyResult &result) {
+        if (result.policyType() != SupportedTypes::Client::ALLOW_PER_LIFE
+                && result.policyType() != SupportedTypes::Client::DENY_PER_LIFE)
+            return;
+        std::uint64_t epoch = m_state->epoch.load();
+        if (m_epoch.empty() || epoch != m_epochValue) {
+            m_epochValue = epoch;
+            m_epoch = std::to_string(epoch);
+        }
+        result = PolicyResult(result.policyType(), m_epoch);
+    }
 };
 
+namespace {
+
+// Exceptions must not cross C boundary of entry points
+void invalidateComponent(ExternalPluginInterface *ptr, KeyComponent component,
+                         const char *value) noexcept {
+    if (!ptr || !value) {
+        LOGE("Invalid arguments of invalidation");
+        return;
+    }
+    try {
+        static_cast<AskUserPlugin *>(ptr)->invalidate(component, value);
+    } catch (const std::exception &e) {
+        LOGE("Failed with std exception: " << e.what());
+    } catch (...) {
+        LOGE("Failed with unknown exception: ");
+    }
+}
+
+} // namespace
+
 } // namespace AskUser
 
 extern "C" {
@@ -148,4 +521,50 @@ ExternalPluginInterface *create(void) {
 void destroy(ExternalPluginInterface *ptr) {
     delete ptr;
 }
+
+/*
+ * Cynara plugin interface carries only global invalidation. These entry points let a host
+ * which knows which client was uninstalled, user was removed or privilege changed drop
+ * only affected decisions.
+ */
+void invalidateClient(ExternalPluginInterface *ptr, const char *client) {
+    AskUser::invalidateComponent(ptr, CLIENT, client);
+}
+
+void invalidateUser(ExternalPluginInterface *ptr, const char *user) {
+    AskUser::invalidateComponent(ptr, USER, user);
+}
+
+void invalidatePrivilege(ExternalPluginInterface *ptr, const char *privilege) {
+    AskUser::invalidateComponent(ptr, PRIVILEGE, privilege);
+}
+
+/*
+ * Checks many privileges of one client and user at once, e.g. all privileges of application
+ * being launched. Types get answers of privileges in the same order, misses (count long) get
+ * indexes of privileges which need to be checked through cynara, as they may need a prompt,
+ * and missCount their number; types of missed privileges are left untouched. Lifetime answers
+ * are valid until epoch changes, like those of check() carrying it as metadata; epoch is 0
+ * without shared state. Calls must be serialized with other calls of plugin, like cynara does.
+ * Returns 0 on success, -1 on failure.
+ */
+int checkPrivileges(ExternalPluginInterface *ptr, const char *client, const char *user,
+                    const char *const *privileges, size_t count, uint16_t *types,
+                    uint32_t *misses, size_t *missCount, uint64_t *epoch) {
+    if (!ptr || !client || !user || (count && (!privileges || !types || !misses))
+        || !missCount || !epoch) {
+        LOGE("Invalid arguments of checkPrivileges");
+        return -1;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (!privileges[i]) {
+            LOGE("Invalid arguments of checkPrivileges");
+            return -1;
+        }
+    }
+    return static_cast<AskUser::AskUserPlugin *>(ptr)->checkPrivileges(client, user, privileges,
+                                                                       count, types, misses,
+                                                                       *missCount, *epoch)
+           ? 0 : -1;
+}
 } // extern "C"
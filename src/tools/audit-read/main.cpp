@@ -0,0 +1,380 @@
+/*
+ *  Copyright (c) 2015 Samsung Electronics Co.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/**
+ * @file        main.cpp
+ * @author      Zofia Abramowska <z.abramowska@samsung.com>
+ * @brief       Tool querying binary audit log of decisions given by agent
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <fstream>
+#include <map>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+
+#include <audit/AuditRecord.h>
+#include <types/SupportedTypes.h>
+
+using namespace AskUser;
+using namespace AskUser::Audit;
+
+namespace {
+
+enum class Field {
+    None,
+    Client,
+    User,
+    Privilege,
+    Outcome
+};
+
+struct Options {
+    const char *client = nullptr;
+    const char *user = nullptr;
+    const char *privilege = nullptr;
+    bool filterOutcome = false;
+    Outcome outcome = Outcome::Rule;
+    std::uint64_t from = 0;
+    std::uint64_t to = UINT64_MAX;
+    Field group = Field::None;
+} options;
+
+struct Group {
+    std::uint64_t count = 0;
+    std::uint64_t granted = 0;
+    std::uint64_t latencySum = 0;
+    std::uint32_t latencyMax = 0;
+};
+
+typedef std::unordered_map<std::uint32_t, std::string> Dictionary;
+
+// Filters are compared as ids, which are different in every log
+struct IdFilter {
+    bool set = false;
+    std::uint32_t id = 0;
+};
+
+bool isGranted(std::uint16_t answer) {
+    using namespace SupportedTypes::Client;
+    return answer == Cynara::PredefinedPolicyType::ALLOW || answer == ALLOW_ONCE
+           || answer == ALLOW_PER_SESSION || answer == ALLOW_PER_LIFE;
+}
+
+std::string answerName(std::uint16_t answer) {
+    using namespace SupportedTypes::Client;
+    switch (answer) {
+    case Cynara::PredefinedPolicyType::ALLOW:
+        return "allow";
+    case Cynara::PredefinedPolicyType::DENY:
+        return "deny";
+    case ALLOW_ONCE:
+        return "allow-once";
+    case ALLOW_PER_SESSION:
+        return "allow-session";
+    case ALLOW_PER_LIFE:
+        return "allow-life";
+    case DENY_ONCE:
+        return "deny-once";
+    case DENY_PER_SESSION:
+        return "deny-session";
+    case DENY_PER_LIFE:
+        return "deny-life";
+    }
+    return std::to_string(answer);
+}
+
+bool parseOutcome(const char *name, Outcome &outcome) {
+    for (auto candidate : {Outcome::Rule, Outcome::User, Outcome::Timeout, Outcome::Error}) {
+        if (!strcmp(name, outcomeName(candidate))) {
+            outcome = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseField(const char *name, Field &field) {
+    static const std::map<std::string, Field> fields = {
+        {"client", Field::Client},
+        {"user", Field::User},
+        {"privilege", Field::Privilege},
+        {"outcome", Field::Outcome}
+    };
+    auto it = fields.find(name);
+    if (it == fields.end())
+        return false;
+    field = it->second;
+    return true;
+}
+
+bool parseSeconds(const char *text, std::uint64_t &nanoseconds) {
+    char *end;
+    errno = 0;
+    unsigned long long seconds = strtoull(text, &end, 10);
+    if (errno || end == text || *end)
+        return false;
+    nanoseconds = seconds * 1000000000ULL;
+    return true;
+}
+
+bool loadDictionary(const std::string &logPath, Dictionary &dictionary) {
+    std::ifstream file(dictionaryPath(logPath));
+    if (!file.is_open()) {
+        fprintf(stderr, "Unable to open dictionary <%s>\n", dictionaryPath(logPath).c_str());
+        return false;
+    }
+    // Agent never redefines id, so only the first definition counts
+    std::uint32_t id;
+    std::string escaped, value;
+    while (file >> id && file.get() == ' ' && std::getline(file, escaped)) {
+        if (!unescapeValue(escaped, value)) {
+            fprintf(stderr, "Malformed value of id [%" PRIu32 "] in dictionary <%s>\n", id,
+                    dictionaryPath(logPath).c_str());
+            return false;
+        }
+        dictionary.insert(std::make_pair(id, value));
+    }
+    return true;
+}
+
+// Returns false if value does not occur in log at all, so no record can match
+bool resolve(const Dictionary &dictionary, const char *value, IdFilter &filter) {
+    if (!value)
+        return true;
+    for (const auto &entry : dictionary) {
+        if (entry.second == value) {
+            filter.set = true;
+            filter.id = entry.first;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool matches(const IdFilter &filter, std::uint32_t id) {
+    return !filter.set || filter.id == id;
+}
+
+const std::string &lookup(const Dictionary &dictionary, std::uint32_t id) {
+    static const std::string unknown = "?";
+    auto it = dictionary.find(id);
+    return it != dictionary.end() ? it->second : unknown;
+}
+
+std::string groupKey(const Dictionary &dictionary, const Record &record) {
+    switch (options.group) {
+    case Field::Client:
+        return lookup(dictionary, record.client);
+    case Field::User:
+        return lookup(dictionary, record.user);
+    case Field::Privilege:
+        return lookup(dictionary, record.privilege);
+    case Field::Outcome:
+        return outcomeName(record.outcome);
+    case Field::None:
+        break;
+    }
+    return std::string();
+}
+
+// Values are printed escaped, so one of them cannot pass for another record
+void printRecord(const Dictionary &dictionary, const Record &record) {
+    time_t seconds = static_cast<time_t>(record.time / 1000000000ULL);
+    unsigned millis = static_cast<unsigned>(record.time / 1000000ULL % 1000);
+    struct tm local;
+    char date[32];
+    localtime_r(&seconds, &local);
+    strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", &local);
+
+    printf("%s.%03u %-7s %-13s %6" PRIu32 "ms %s %s %s\n", date, millis,
+           outcomeName(record.outcome), answerName(record.answer).c_str(), record.latency,
+           escapeValue(lookup(dictionary, record.client)).c_str(),
+           escapeValue(lookup(dictionary, record.user)).c_str(),
+           escapeValue(lookup(dictionary, record.privilege)).c_str());
+}
+
+/*
+ * Log is mapped and scanned in place. Records are filtered by comparing ids, strings are only
+ * touched for records which are printed or grouped.
+ */
+bool readLog(const char *path, std::map<std::string, Group> &groups, std::uint64_t &total) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        perror(path);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror(path);
+        close(fd);
+        return false;
+    }
+    std::size_t size = static_cast<std::size_t>(st.st_size);
+    if (size < sizeof(FileHeader)) {
+        fprintf(stderr, "<%s> is not an audit log\n", path);
+        close(fd);
+        return false;
+    }
+    void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("mmap");
+        return false;
+    }
+
+    const FileHeader *header = static_cast<const FileHeader *>(map);
+    if (header->magic != FileHeader::MAGIC || header->version != FileHeader::VERSION
+        || header->recordSize != sizeof(Record)) {
+        fprintf(stderr, "<%s> is not an audit log of supported version\n", path);
+        munmap(map, size);
+        return false;
+    }
+
+    Dictionary dictionary;
+    IdFilter client, user, privilege;
+    if (!loadDictionary(path, dictionary)) {
+        munmap(map, size);
+        return false;
+    }
+    if (!resolve(dictionary, options.client, client) || !resolve(dictionary, options.user, user)
+        || !resolve(dictionary, options.privilege, privilege)) {
+        munmap(map, size);
+        return true;
+    }
+
+    // Record being written when log was mapped is skipped
+    std::size_t count = (size - sizeof(FileHeader)) / sizeof(Record);
+    const Record *records = reinterpret_cast<const Record *>(header + 1);
+    for (std::size_t i = 0; i < count; ++i) {
+        const Record &record = records[i];
+        if (!matches(client, record.client) || !matches(user, record.user)
+            || !matches(privilege, record.privilege)
+            || (options.filterOutcome && record.outcome != options.outcome)
+            || record.time < options.from || record.time >= options.to)
+            continue;
+
+        ++total;
+        if (options.group == Field::None) {
+            printRecord(dictionary, record);
+            continue;
+        }
+        Group &group = groups[groupKey(dictionary, record)];
+        ++group.count;
+        group.granted += isGranted(record.answer);
+        group.latencySum += record.latency;
+        group.latencyMax = std::max(group.latencyMax, record.latency);
+    }
+
+    munmap(map, size);
+    return true;
+}
+
+void printGroups(const std::map<std::string, Group> &groups) {
+    printf("%10s %10s %10s %10s %10s  %s\n", "count", "granted", "denied", "avg ms", "max ms",
+           "key");
+    for (const auto &entry : groups) {
+        const Group &group = entry.second;
+        printf("%10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10.1f %10" PRIu32 "  %s\n",
+               group.count, group.granted, group.count - group.granted,
+               static_cast<double>(group.latencySum) / group.count, group.latencyMax,
+               escapeValue(entry.first).c_str());
+    }
+}
+
+void usage(const char *name) {
+    printf("Usage: %s [options] <log>...\n"
+           "  -c <client>     only decisions for client\n"
+           "  -u <user>       only decisions for user\n"
+           "  -p <privilege>  only decisions for privilege\n"
+           "  -o <outcome>    only decisions of outcome: rule, user, timeout or error\n"
+           "  -f <seconds>    only decisions made since given time (seconds since epoch)\n"
+           "  -t <seconds>    only decisions made before given time (seconds since epoch)\n"
+           "  -g <field>      print totals per client, user, privilege or outcome\n"
+           "Rotated logs can be given together, e.g. audit.log audit.log.1\n", name);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    int opt;
+    while ((opt = getopt(argc, argv, "c:u:p:o:f:t:g:h")) != -1) {
+        switch (opt) {
+        case 'c':
+            options.client = optarg;
+            break;
+        case 'u':
+            options.user = optarg;
+            break;
+        case 'p':
+            options.privilege = optarg;
+            break;
+        case 'o':
+            options.filterOutcome = true;
+            if (!parseOutcome(optarg, options.outcome)) {
+                fprintf(stderr, "Unknown outcome <%s>\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'f':
+            if (!parseSeconds(optarg, options.from)) {
+                fprintf(stderr, "Invalid time <%s>\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 't':
+            if (!parseSeconds(optarg, options.to)) {
+                fprintf(stderr, "Invalid time <%s>\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'g':
+            if (!parseField(optarg, options.group)) {
+                fprintf(stderr, "Unknown field <%s>\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        default:
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (optind == argc) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::map<std::string, Group> groups;
+    std::uint64_t total = 0;
+    bool ok = true;
+    for (int i = optind; i < argc; ++i)
+        ok = readLog(argv[i], groups, total) && ok;
+
+    if (options.group != Field::None)
+        printGroups(groups);
+    fprintf(stderr, "[%" PRIu64 "] decisions matched\n", total);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,105 @@
+/*
+ *  Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/**
+ * @file        main.cpp
+ * @author      Zofia Abramowska <z.abramowska@samsung.com>
+ * @brief       Tool printing statistics of service plugin cache
+ */
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+
+#include <state/PluginState.h>
+
+using namespace AskUser::State;
+
+namespace {
+
+void printCounter(const char *name, const Counter &counter) {
+    printf("%-14s %" PRIu64 "\n", name, get(counter));
+}
+
+void printStats(const CacheStats &stats) {
+    std::uint64_t hits = get(stats.hits);
+    std::uint64_t lookups = hits + get(stats.misses);
+
+    printCounter("size:", stats.size);
+    printCounter("bytes:", stats.bytes);
+    printCounter("budget:", stats.budget);
+    printCounter("overflow:", stats.overflow);
+    printCounter("hits:", stats.hits);
+    printCounter("misses:", stats.misses);
+    printf("%-14s %.2f%%\n", "hit ratio:", lookups ? 100.0 * hits / lookups : 0.0);
+    printCounter("insertions:", stats.insertions);
+    printCounter("updates:", stats.updates);
+    printCounter("evictions:", stats.evictions);
+    printCounter("expirations:", stats.expirations);
+
+    printf("reuse distance:\n");
+    for (unsigned i = 1; i < CacheStats::REUSE_DISTANCE_BUCKETS; ++i) {
+        std::uint64_t count = get(stats.reuseDistance[i]);
+        if (!count)
+            continue;
+        if (i == CacheStats::REUSE_DISTANCE_BUCKETS - 1)
+            printf("    [%" PRIu64 ", inf): %" PRIu64 "\n", std::uint64_t(1) << (i - 1), count);
+        else
+            printf("    [%" PRIu64 ", %" PRIu64 "): %" PRIu64 "\n", std::uint64_t(1) << (i - 1),
+                   std::uint64_t(1) << i, count);
+    }
+}
+
+void printPartitions(const PartitionState &state) {
+    bool header = false;
+    for (const auto &partition : state.partitions) {
+        if (!partition.user[0])
+            continue;
+        if (!header) {
+            printf("partitions:\n    %-12s %8s %8s %8s %10s %10s %10s %10s\n", "user", "quota",
+                   "size", "overflow", "hits", "misses", "evictions", "demotions");
+            header = true;
+        }
+        printf("    %-12.*s %8" PRIu64 " %8" PRIu64 " %8" PRIu64 " %10" PRIu64 " %10" PRIu64
+               " %10" PRIu64 " %10" PRIu64 "\n", static_cast<int>(PartitionStats::USER_SIZE),
+               partition.user, get(partition.quota), get(partition.size),
+               get(partition.overflow), get(partition.hits), get(partition.misses),
+               get(partition.evictions), get(partition.demotions));
+    }
+}
+
+} // namespace
+
+int main(void) {
+    const PluginState *state = mapPluginState(false);
+    if (!state) {
+        fprintf(stderr, "Service plugin state is not available\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("%-14s %" PRIu64 "\n", "epoch:", state->epoch.load());
+    printStats(state->cache);
+    printCounter("shrinks:", state->pressureShrinks);
+    printCounter("restores:", state->pressureRestores);
+    // Partitions name users, so only owner of service plugin and root can read them
+    const PartitionState *partitions = mapPartitionState(false);
+    if (partitions) {
+        printPartitions(*partitions);
+        unmapPartitionState(partitions);
+    }
+
+    unmapPluginState(state);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,166 @@
+/*
+ *  Copyright (c) 2015 Samsung Electronics Co.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/**
+ * @file        main.cpp
+ * @author      Zofia Abramowska <z.abramowska@samsung.com>
+ * @brief       Tool dumping spans of plugin and agent as Chrome trace JSON
+ */
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include <trace/SpanRing.h>
+
+using namespace AskUser::Trace;
+
+namespace {
+
+struct ComponentSpan {
+    const char *component;
+    Span span;
+};
+
+void readRing(const char *component, std::vector<ComponentSpan> &spans) {
+    const SpanRing *ring = mapSpanRing(component, false);
+    if (!ring) {
+        fprintf(stderr, "Spans of <%s> are not available\n", component);
+        return;
+    }
+
+    std::uint64_t next = ring->next.load();
+    std::uint64_t first = next > SpanRing::RING_CAPACITY ? next - SpanRing::RING_CAPACITY : 0;
+    for (std::uint64_t index = first; index < next; ++index) {
+        ComponentSpan span;
+        span.component = component;
+        if (readSpan(*ring, static_cast<std::uint32_t>(index % SpanRing::RING_CAPACITY),
+                     span.span))
+            spans.push_back(span);
+    }
+    unmapSpanRing(ring);
+}
+
+double micros(Timestamp timestamp) {
+    return timestamp / 1000.0;
+}
+
+void printEvent(FILE *out, bool &first, const std::string &event) {
+    fprintf(out, "%s\n    %s", first ? "" : ",", event.c_str());
+    first = false;
+}
+
+/*
+ * Every span is a complete event. Spans of one request are linked by flow events, which
+ * trace viewers draw as arrows from plugin through agent and back.
+ */
+void printTrace(FILE *out, std::vector<ComponentSpan> &spans) {
+    std::sort(spans.begin(), spans.end(), [](const ComponentSpan &a, const ComponentSpan &b) {
+        return a.span.start < b.span.start;
+    });
+
+    std::map<CorrelationId, std::vector<const ComponentSpan *>> requests;
+    std::map<std::uint32_t, const char *> processes;
+    for (const auto &span : spans) {
+        if (span.span.correlationId)
+            requests[span.span.correlationId].push_back(&span);
+        processes[span.span.pid] = span.component;
+    }
+
+    char buffer[512];
+    bool first = true;
+    fprintf(out, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [");
+    for (const auto &process : processes) {
+        snprintf(buffer, sizeof(buffer),
+                 "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %" PRIu32 ","
+                 " \"args\": {\"name\": \"%s\"}}", process.first, process.second);
+        printEvent(out, first, buffer);
+    }
+    for (const auto &span : spans) {
+        snprintf(buffer, sizeof(buffer),
+                 "{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"ts\": %.3f,"
+                 " \"dur\": %.3f, \"pid\": %" PRIu32 ", \"tid\": %" PRIu32 ","
+                 " \"args\": {\"correlation\": \"%" PRIx64 "\"}}",
+                 span.span.name, span.component, micros(span.span.start),
+                 micros(span.span.end - span.span.start), span.span.pid, span.span.tid,
+                 span.span.correlationId);
+        printEvent(out, first, buffer);
+    }
+    for (const auto &request : requests) {
+        const auto &steps = request.second;
+        for (std::size_t i = 0; i < steps.size() && steps.size() > 1; ++i) {
+            const char *phase = i == 0 ? "s" : i + 1 == steps.size() ? "f" : "t";
+            snprintf(buffer, sizeof(buffer),
+                     "{\"name\": \"request\", \"cat\": \"request\", \"ph\": \"%s\","
+                     " \"id\": \"%" PRIx64 "\", \"ts\": %.3f, \"pid\": %" PRIu32 ","
+                     " \"tid\": %" PRIu32 "%s}",
+                     phase, request.first, micros(steps[i]->span.start), steps[i]->span.pid,
+                     steps[i]->span.tid, i + 1 == steps.size() ? ", \"bp\": \"e\"" : "");
+            printEvent(out, first, buffer);
+        }
+    }
+    fprintf(out, "\n]}\n");
+}
+
+void usage(const char *name) {
+    printf("Usage: %s [-o <file>] [<component>...]\n"
+           "  -o <file>  write trace to file instead of standard output\n"
+           "Components are \"plugin\" and \"agent\" if none is given.\n"
+           "Trace can be opened in chrome://tracing or ui.perfetto.dev.\n", name);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const char *path = nullptr;
+    int opt;
+    while ((opt = getopt(argc, argv, "o:h")) != -1) {
+        switch (opt) {
+        case 'o':
+            path = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::vector<const char *> components(argv + optind, argv + argc);
+    if (components.empty())
+        components = {"plugin", "agent"};
+
+    std::vector<ComponentSpan> spans;
+    for (const char *component : components)
+        readRing(component, spans);
+
+    FILE *out = path ? fopen(path, "w") : stdout;
+    if (!out) {
+        perror("fopen");
+        return EXIT_FAILURE;
+    }
+    printTrace(out, spans);
+    if (path && fclose(out) != 0) {
+        perror("fclose");
+        return EXIT_FAILURE;
+    }
+    if (path)
+        fprintf(stderr, "Dumped [%zu] spans to <%s>\n", spans.size(), path);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,265 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+/**
+ * @file        main.cpp
+ * @author      Adam Malinowski <a.malinowsk2@partner.samsung.com>
+ * @brief       Test checking that agent processes requests without allocating memory
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+#include <translator/Translator.h>
+#include <types/AgentErrorMsg.h>
+#include <types/SupportedTypes.h>
+
+#include <log/alog.h>
+#include <main/Agent.h>
+
+#include "FakeCynara.h"
+#include "FakeScope.h"
+#include "FakeUI.h"
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void __libc_free(void *ptr);
+}
+
+using namespace AskUser;
+using namespace AskUser::Agent;
+using AskUser::Test::FakeAnswer;
+using AskUser::Test::FakeCynara;
+using AskUser::Test::FakeScope;
+using AskUser::Test::FakeUIFactory;
+
+namespace {
+
+std::atomic<bool> counting(false);
+std::atomic<unsigned long> allocations(0);
+
+// Fake cynara and fake prompts stand for cynara library and notification, which allocate
+void count() {
+    if (counting.load(std::memory_order_relaxed) && !FakeScope::active())
+        allocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+const unsigned WARMUP_ROUNDS = 2000;
+const unsigned TEST_ROUNDS = 20000;
+
+const char *const rules =
+    "allow org.tizen.* * http://tizen.org/privilege/camera\n"
+    "deny * 5001 http://tizen.org/privilege/location*\n";
+
+// Every round sends each kind of request once, under ID of its kind
+enum Kind {
+    Allowed,   // allowed by rule
+    Denied,    // denied by rule
+    Prompted,  // answered by user
+    Cancelled, // cancelled by cynara, before user answers
+    KindCount
+};
+
+std::mutex mutex;
+std::condition_variable answered;
+unsigned pending = 0;
+unsigned long wrong = 0;
+
+Cynara::PluginData allowAnswer;
+Cynara::PluginData denyAnswer;
+
+FakeAnswer answerByKind(RequestId id) {
+    FakeAnswer answer{true, true, URT_YES_ONCE, std::chrono::microseconds(0),
+                      std::chrono::microseconds(0)};
+    // Answer comes for request already cancelled, after its ID is given to the next one
+    if (id == Cancelled)
+        answer.delay = std::chrono::milliseconds(5);
+    return answer;
+}
+
+void handleResponse(cynara_agent_msg_type type, cynara_agent_req_id id,
+                    const std::string &data) {
+    bool correct = false;
+    switch (id) {
+    case Allowed:
+    case Prompted:
+        correct = type == CYNARA_MSG_TYPE_ACTION && data == allowAnswer;
+        break;
+    case Denied:
+        correct = type == CYNARA_MSG_TYPE_ACTION && data == denyAnswer;
+        break;
+    case Cancelled:
+        correct = type == CYNARA_MSG_TYPE_CANCEL;
+        break;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!correct) {
+        ++wrong;
+        fprintf(stderr, "Wrong response to request [%u]\n", id);
+    }
+    --pending;
+    answered.notify_one();
+}
+
+bool runRound(const std::vector<Cynara::PluginData> &payloads) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = KindCount;
+    }
+    for (RequestId id = 0; id < KindCount; ++id)
+        FakeCynara::instance().send(CYNARA_MSG_TYPE_ACTION, id, payloads[id]);
+    FakeCynara::instance().send(CYNARA_MSG_TYPE_CANCEL, Cancelled);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    return answered.wait_for(lock, std::chrono::seconds(5), [] { return pending == 0; });
+}
+
+} // namespace
+
+extern "C" {
+void *malloc(size_t size) {
+    count();
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count_, size_t size) {
+    count();
+    return __libc_calloc(count_, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    count();
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) {
+    __libc_free(ptr);
+}
+} // extern "C"
+
+void *operator new(std::size_t size) {
+    count();
+    void *ptr = __libc_malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void *operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept {
+    __libc_free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+    __libc_free(ptr);
+}
+
+/*
+ * Agent is driven through fake cynara and fake prompts, so every request takes the same path
+ * as in the daemon: received by cynara thread, routed by agent loop, answered by rules or
+ * handled by user worker, which starts prompt and waits for its answer or for cancel.
+ */
+int main(void) {
+    init_agent_log();
+
+    char rulesPath[] = "/tmp/askuser-test-alloc-XXXXXX";
+    int fd = mkstemp(rulesPath);
+    if (fd < 0) {
+        perror("mkstemp");
+        return EXIT_FAILURE;
+    }
+    std::string rulesContent(rules);
+    if (write(fd, rulesContent.data(), rulesContent.size())
+            != static_cast<ssize_t>(rulesContent.size())) {
+        perror("write");
+        close(fd);
+        unlink(rulesPath);
+        return EXIT_FAILURE;
+    }
+    close(fd);
+
+    setenv("ASKUSER_RULES", rulesPath, 1);
+    // Saving snapshot and audit log are file operations, which allocate
+    setenv("ASKUSER_SNAPSHOT", "", 1);
+    setenv("ASKUSER_AUDIT_LOG", "", 1);
+    setenv("ASKUSER_BATCH_WINDOW_MS", "1", 0);
+
+    std::vector<Cynara::PluginData> payloads = {
+        Translator::Plugin::requestToData("org.tizen.camera", "5001",
+                                          "http://tizen.org/privilege/camera"),
+        Translator::Plugin::requestToData("com.example.maps", "5001",
+                                          "http://tizen.org/privilege/location.coarse"),
+        Translator::Plugin::requestToData("com.example.other", "5002",
+                                          "http://tizen.org/privilege/contact.read"),
+        Translator::Plugin::requestToData("com.example.cancelled", "5003",
+                                          "http://tizen.org/privilege/calendar.read"),
+    };
+    allowAnswer = Translator::Agent::answerToData(SupportedTypes::Client::ALLOW_ONCE,
+                                                  AgentErrorMsg::NoError);
+    denyAnswer = Translator::Agent::answerToData(SupportedTypes::Client::DENY_ONCE,
+                                                 AgentErrorMsg::NoError);
+
+    FakeCynara::instance().setResponseHandler(handleResponse);
+    FakeUIFactory factory(answerByKind, std::chrono::seconds(1));
+
+    bool finished = true;
+    {
+        AskUser::Agent::Agent agent(factory);
+        if (!agent.start()) {
+            unlink(rulesPath);
+            return EXIT_FAILURE;
+        }
+        std::thread agentThread(&AskUser::Agent::Agent::run, &agent);
+
+        for (unsigned i = 0; i < WARMUP_ROUNDS + TEST_ROUNDS && finished; ++i) {
+            if (i == WARMUP_ROUNDS)
+                counting = true;
+            finished = runRound(payloads);
+        }
+        counting = false;
+
+        FakeCynara::instance().close();
+        agentThread.join();
+    }
+    unlink(rulesPath);
+
+    printf("Processed %u rounds of %u requests, %lu allocations\n", TEST_ROUNDS,
+           static_cast<unsigned>(KindCount), allocations.load());
+    if (!finished || wrong) {
+        printf("FAILED: agent did not answer every request correctly\n");
+        return EXIT_FAILURE;
+    }
+    if (allocations.load()) {
+        printf("FAILED: steady state request path allocates memory\n");
+        return EXIT_FAILURE;
+    }
+    printf("PASSED\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,226 @@
+/*
+ *  Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/**
+ * @file        main.cpp
+ * @author      Zofia Abramowska <z.abramowska@samsung.com>
+ * @brief       Compares hit ratios of CapacityCache eviction policies on synthetic traces and
+ *              on requests recorded by agent
+ */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ostream>
+#include <random>
+#include <set>
+#include <string>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+#include <CapacityCache.h>
+#include <main/RequestTrace.h>
+
+typedef std::array<std::uint32_t, 3> Key;
+
+std::ostream &operator<<(std::ostream &os, const Key &key) {
+    os << key[0] << "/" << key[1] << "/" << key[2];
+    return os;
+}
+
+namespace {
+
+const std::uint32_t HOT_KEYS = 50;
+const std::uint32_t ZIPF_KEYS = 1000;
+const double ZIPF_SKEW = 0.99;
+
+struct Options {
+    std::size_t capacity = 100;
+    std::size_t requests = 1000000;
+    unsigned seed = 1;
+    const char *path = nullptr;
+};
+
+// Trace is a sequence of keys, the same one is replayed against every policy
+typedef std::vector<Key> Trace;
+
+Key indexKey(std::uint32_t index) {
+    return Key{{index, 0, 0}};
+}
+
+// Hot keys used over and over, every second request is a key never used again
+Trace hotScanTrace(const Options &options) {
+    std::mt19937 random(options.seed);
+    std::uniform_int_distribution<std::uint32_t> hot(0, HOT_KEYS - 1);
+    Trace trace(options.requests);
+    std::uint32_t scanned = HOT_KEYS;
+    for (auto &key : trace)
+        key = indexKey(random() % 2 ? hot(random) : scanned++);
+    return trace;
+}
+
+Trace zipfTrace(const Options &options) {
+    std::vector<double> cdf(ZIPF_KEYS);
+    double sum = 0;
+    for (std::uint32_t i = 0; i < ZIPF_KEYS; ++i) {
+        sum += 1.0 / std::pow(static_cast<double>(i + 1), ZIPF_SKEW);
+        cdf[i] = sum;
+    }
+    for (auto &value : cdf)
+        value /= sum;
+
+    std::mt19937 random(options.seed);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    Trace trace(options.requests);
+    for (auto &key : trace) {
+        auto it = std::lower_bound(cdf.begin(), cdf.end(), uniform(random));
+        key = indexKey(std::min<std::uint32_t>(it - cdf.begin(), ZIPF_KEYS - 1));
+    }
+    return trace;
+}
+
+// Keys used in a loop a bit longer than capacity, worst case of LRU
+Trace loopTrace(const Options &options) {
+    std::uint32_t keys = options.capacity + options.capacity / 5;
+    Trace trace(options.requests);
+    for (std::size_t i = 0; i < trace.size(); ++i)
+        trace[i] = indexKey(i % keys);
+    return trace;
+}
+
+// Every identifier gets its own id, like in intern table of service plugin
+class Ids {
+public:
+    std::uint32_t get(const std::string &value) {
+        auto id = static_cast<std::uint32_t>(m_ids.size());
+        return m_ids.insert(std::make_pair(value, id)).first->second;
+    }
+
+private:
+    std::unordered_map<std::string, std::uint32_t> m_ids;
+};
+
+// Requests recorded by agent with ASKUSER_TRACE, cancels and responses are skipped
+bool recordedTrace(const char *path, Trace &trace, std::size_t &keys) {
+    AskUser::Agent::RequestTraceReader reader;
+    if (!reader.open(path)) {
+        fprintf(stderr, "Unable to open trace <%s>\n", path);
+        return false;
+    }
+    Ids clients, users, privileges;
+    std::set<Key> distinct;
+    AskUser::Agent::TraceRecord record;
+    while (reader.next(record)) {
+        if (record.event != AskUser::Agent::TraceEvent::Request)
+            continue;
+        trace.push_back(Key{{clients.get(record.request.client), users.get(record.request.user),
+                             privileges.get(record.request.privilege)}});
+        distinct.insert(trace.back());
+    }
+    keys = distinct.size();
+    return true;
+}
+
+// Missing key is inserted, like service plugin does with answer of agent
+template<template<class> class Policy>
+double hitRatio(const Options &options, const Trace &trace) {
+    Plugin::CapacityCache<Key, int, Policy> cache(options.capacity);
+    std::size_t hits = 0;
+    int value;
+    for (const auto &key : trace) {
+        if (cache.get(key, value))
+            ++hits;
+        else
+            cache.update(key, 0);
+    }
+    return trace.empty() ? 0 : static_cast<double>(hits) / trace.size();
+}
+
+void compare(const char *name, const Options &options, const Trace &trace) {
+    printf("%-10s %8.4f %8.4f %8.4f\n", name,
+           hitRatio<Plugin::LRUPolicy>(options, trace),
+           hitRatio<Plugin::ClockPolicy>(options, trace),
+           hitRatio<Plugin::TwoQueuePolicy>(options, trace));
+}
+
+void usage(const char *name) {
+    printf("Usage: %s [options]\n"
+           "  -c <count>    capacity of cache (default 100)\n"
+           "  -n <count>    requests in every trace (default 1000000)\n"
+           "  -r <seed>     seed of random traces (default 1)\n"
+           "  -f <path>     compare on requests recorded by agent to trace file instead\n",
+           name);
+}
+
+bool parseOptions(int argc, char **argv, Options &options) {
+    int opt;
+    while ((opt = getopt(argc, argv, "c:n:r:f:h")) != -1) {
+        switch (opt) {
+        case 'c':
+            options.capacity = strtoull(optarg, nullptr, 10);
+            break;
+        case 'n':
+            options.requests = strtoull(optarg, nullptr, 10);
+            break;
+        case 'r':
+            options.seed = strtoul(optarg, nullptr, 10);
+            break;
+        case 'f':
+            options.path = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return false;
+        }
+    }
+    if (!options.capacity) {
+        fprintf(stderr, "Capacity must be positive\n");
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options))
+        return EXIT_FAILURE;
+
+    if (options.path) {
+        Trace trace;
+        std::size_t keys;
+        if (!recordedTrace(options.path, trace, keys))
+            return EXIT_FAILURE;
+        // First request of every key misses whatever the policy is
+        printf("capacity %zu, %zu recorded requests of %zu keys, best hit ratio %.4f\n",
+               options.capacity, trace.size(), keys,
+               trace.empty() ? 0 : 1 - static_cast<double>(keys) / trace.size());
+        printf("%-10s %8s %8s %8s\n", "trace", "LRU", "CLOCK", "2Q");
+        compare("recorded", options, trace);
+        return EXIT_SUCCESS;
+    }
+
+    printf("capacity %zu, %zu requests per trace\n", options.capacity, options.requests);
+    printf("%-10s %8s %8s %8s\n", "trace", "LRU", "CLOCK", "2Q");
+    compare("hot+scan", options, hotScanTrace(options));
+    compare("zipf", options, zipfTrace(options));
+    compare("loop", options, loopTrace(options));
+    return EXIT_SUCCESS;
+}
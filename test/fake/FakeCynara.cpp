@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+/**
+ * @file        FakeCynara.cpp
+ * @author      Adam Malinowski <a.malinowsk2@partner.samsung.com>
+ * @brief       This file implements in-process stand-in of cynara agent library
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+#include <attributes/attributes.h>
+
+#include "FakeCynara.h"
+#include "FakeScope.h"
+
+struct cynara_agent {};
+
+namespace AskUser {
+
+namespace Test {
+
+FakeCynara &FakeCynara::instance() {
+    static FakeCynara cynara;
+    return cynara;
+}
+
+void FakeCynara::setResponseHandler(ResponseHandler handler) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_responseHandler = std::move(handler);
+}
+
+void FakeCynara::send(cynara_agent_msg_type type, cynara_agent_req_id id,
+                      const std::string &data) {
+    FakeScope scope;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_messages.push_back(Message{type, id, data});
+    m_event.notify_one();
+}
+
+void FakeCynara::close() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_closed = true;
+    m_event.notify_one();
+}
+
+int FakeCynara::getRequest(cynara_agent_msg_type *type, cynara_agent_req_id *id, void **data,
+                           size_t *dataSize) {
+    // Payload is allocated by cynara library as well
+    FakeScope scope;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_event.wait(lock, [this] { return m_closed || !m_messages.empty(); });
+    if (m_messages.empty()) {
+        return CYNARA_API_SERVICE_NOT_AVAILABLE;
+    }
+
+    Message message = std::move(m_messages.front());
+    m_messages.pop_front();
+    lock.unlock();
+
+    *type = message.type;
+    *id = message.id;
+    *dataSize = message.data.size();
+    *data = nullptr;
+    if (!message.data.empty()) {
+        *data = malloc(message.data.size());
+        if (!*data) {
+            return CYNARA_API_OUT_OF_MEMORY;
+        }
+        memcpy(*data, message.data.data(), message.data.size());
+    }
+    return CYNARA_API_SUCCESS;
+}
+
+int FakeCynara::putResponse(cynara_agent_msg_type type, cynara_agent_req_id id,
+                            const void *data, size_t dataSize) {
+    FakeScope scope;
+    ResponseHandler handler;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        handler = m_responseHandler;
+    }
+    if (handler) {
+        handler(type, id, std::string(static_cast<const char *>(data), data ? dataSize : 0));
+    }
+    return CYNARA_API_SUCCESS;
+}
+
+} // namespace Test
+
+} // namespace AskUser
+
+using AskUser::Test::FakeCynara;
+
+int cynara_agent_initialize(cynara_agent **pp_cynara_agent, const char *p_agent_type UNUSED) {
+    static cynara_agent agent;
+    *pp_cynara_agent = &agent;
+    return CYNARA_API_SUCCESS;
+}
+
+int cynara_agent_get_request(cynara_agent *p_cynara_agent UNUSED,
+                             cynara_agent_msg_type *req_type, cynara_agent_req_id *req_id,
+                             void **data, size_t *data_size) {
+    return FakeCynara::instance().getRequest(req_type, req_id, data, data_size);
+}
+
+int cynara_agent_put_response(cynara_agent *p_cynara_agent UNUSED,
+                              const cynara_agent_msg_type resp_type,
+                              const cynara_agent_req_id req_id, const void *data,
+                              const size_t data_size) {
+    return FakeCynara::instance().putResponse(resp_type, req_id, data, data_size);
+}
+
+int cynara_agent_finish(cynara_agent *p_cynara_agent UNUSED) {
+    return CYNARA_API_SUCCESS;
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+/**
+ * @file        FakeCynara.h
+ * @author      Adam Malinowski <a.malinowsk2@partner.samsung.com>
+ * @brief       This file declares in-process stand-in of cynara agent library
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+
+#include <cynara-agent.h>
+
+namespace AskUser {
+
+namespace Test {
+
+/*
+ * Implements cynara_agent_* functions, so agent linked with it talks to the test instead
+ * of cynara service. Closing it makes agent stop, as if connection to cynara was lost.
+ */
+class FakeCynara {
+public:
+    typedef std::function<void(cynara_agent_msg_type, cynara_agent_req_id,
+                               const std::string &)> ResponseHandler;
+
+    static FakeCynara &instance();
+
+    // Must be set before agent is started, called in agent threads
+    void setResponseHandler(ResponseHandler handler);
+    void send(cynara_agent_msg_type type, cynara_agent_req_id id,
+              const std::string &data = std::string());
+    void close();
+
+    int getRequest(cynara_agent_msg_type *type, cynara_agent_req_id *id, void **data,
+                   size_t *dataSize);
+    int putResponse(cynara_agent_msg_type type, cynara_agent_req_id id, const void *data,
+                    size_t dataSize);
+
+private:
+    struct Message {
+        cynara_agent_msg_type type;
+        cynara_agent_req_id id;
+        std::string data;
+    };
+
+    FakeCynara() : m_closed(false) {}
+
+    std::mutex m_mutex;
+    std::condition_variable m_event;
+    std::deque<Message> m_messages;
+    bool m_closed;
+    ResponseHandler m_responseHandler;
+};
+
+} // namespace Test
+
+} // namespace AskUser
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+/**
+ * @file        FakeScope.h
+ * @author      Adam Malinowski <a.malinowsk2@partner.samsung.com>
+ * @brief       This file defines marker of code run by fakes in threads of agent
+ */
+
+#pragma once
+
+namespace AskUser {
+
+namespace Test {
+
+/*
+ * Marks code of fake cynara and fake prompts, which stand for cynara library and notification
+ * service. Test counting allocations of agent skips allocations made within the scope.
+ */
+class FakeScope {
+public:
+    FakeScope() {
+        ++depth();
+    }
+    ~FakeScope() {
+        --depth();
+    }
+    FakeScope(const FakeScope &) = delete;
+    FakeScope &operator=(const FakeScope &) = delete;
+
+    static bool active() {
+        return depth() > 0;
+    }
+
+private:
+    static int &depth() {
+        static thread_local int depth = 0;
+        return depth;
+    }
+};
+
+} // namespace Test
+
+} // namespace AskUser
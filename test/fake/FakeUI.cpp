@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+/**
+ * @file        FakeUI.cpp
+ * @author      Adam Malinowski <a.malinowsk2@partner.samsung.com>
+ * @brief       This file implements UI answering prompts without user
+ */
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <attributes/attributes.h>
+
+#include "FakeScope.h"
+#include "FakeUI.h"
+
+using namespace AskUser::Agent;
+
+namespace AskUser {
+
+namespace Test {
+
+class FakeUI : public AskUIInterface {
+public:
+    FakeUI(FakeUIFactory &factory, int id) : m_factory(factory), m_id(id), m_dismissing(false),
+                                             m_stopping(false), m_finished(false) {
+        ++m_factory.m_liveUIs;
+    }
+
+    virtual ~FakeUI() {
+        // Agent may be stopped before prompt is over
+        if (m_thread.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stopping = true;
+            }
+            m_event.notify_one();
+            m_thread.join();
+        }
+        --m_factory.m_liveUIs;
+    }
+
+    virtual bool start(const std::string &client, const std::string &user,
+                       const std::string &privilege, RequestId requestId,
+                       UIResponseCallback responseCallback) {
+        return start(client, user, {PrivilegeRequest(requestId, privilege)}, responseCallback);
+    }
+
+    virtual bool start(const std::string &client UNUSED, const std::string &user UNUSED,
+                       const std::vector<PrivilegeRequest> &privileges,
+                       UIResponseCallback responseCallback) {
+        FakeScope scope;
+        std::vector<FakeAnswer> answers;
+        for (const auto &privilege : privileges) {
+            answers.push_back(m_factory.answer(privilege.first));
+        }
+        if (!answers.empty()) {
+            std::this_thread::sleep_for(answers.front().startDelay);
+        }
+        // Prompt starts or fails as a whole
+        if (answers.empty() || !answers.front().started) {
+            return false;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        bool unanswered = false;
+        std::vector<Answer> schedule;
+        for (std::size_t i = 0; i < privileges.size(); ++i) {
+            if (answers[i].answered) {
+                schedule.push_back(Answer{now + answers[i].delay, privileges[i].first,
+                                          answers[i].response});
+            } else {
+                unanswered = true;
+            }
+        }
+        std::sort(schedule.begin(), schedule.end(), [](const Answer &lhs, const Answer &rhs) {
+            return lhs.time < rhs.time;
+        });
+        auto end = unanswered ? now + m_factory.timeout() : now;
+
+        m_expiry = std::chrono::system_clock::now() + m_factory.timeout();
+        m_thread = std::thread(&FakeUI::run, this, std::move(schedule), end, responseCallback);
+        return true;
+    }
+
+    virtual bool attach(int id UNUSED, RequestId requestId UNUSED,
+                        std::chrono::system_clock::time_point expiry UNUSED,
+                        UIResponseCallback responseCallback UNUSED) {
+        return false;
+    }
+
+    virtual int id() const {
+        return m_id;
+    }
+
+    virtual std::chrono::system_clock::time_point expiry() const {
+        return m_expiry;
+    }
+
+    virtual bool setOutdated() {
+        return true;
+    }
+
+    // Like notification, prompt is dismissed only once its thread has finished
+    virtual bool dismiss() {
+        FakeScope scope;
+        m_dismissing = true;
+        if (!m_finished) {
+            return false;
+        }
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+        return true;
+    }
+
+    virtual bool isDismissing() const {
+        return m_dismissing;
+    }
+
+private:
+    struct Answer {
+        std::chrono::steady_clock::time_point time;
+        RequestId requestId;
+        UIResponseType response;
+    };
+
+    FakeUIFactory &m_factory;
+    int m_id;
+    std::chrono::system_clock::time_point m_expiry;
+    bool m_dismissing;
+    std::mutex m_mutex;
+    std::condition_variable m_event;
+    bool m_stopping;
+    std::atomic<bool> m_finished;
+    std::thread m_thread;
+
+    void run(std::vector<Answer> schedule, std::chrono::steady_clock::time_point end,
+             UIResponseCallback responseCallback) {
+        // Counted only while running, so soak may overcount threads, but never undercount them
+        ++m_factory.m_liveThreads;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (const auto &answer : schedule) {
+            if (m_event.wait_until(lock, answer.time, [this] { return m_stopping; })) {
+                break;
+            }
+            lock.unlock();
+            responseCallback(answer.requestId, answer.response);
+            lock.lock();
+        }
+        // Prompt never answering a request stays shown until it expires
+        m_event.wait_until(lock, end, [this] { return m_stopping; });
+        --m_factory.m_liveThreads;
+        m_finished = true;
+    }
+};
+
+FakeUIFactory::FakeUIFactory(FakeAnswerPolicy policy, std::chrono::seconds timeout)
+    : m_policy(policy), m_timeout(timeout), m_nextId(1), m_liveUIs(0), m_liveThreads(0) {}
+
+AskUIInterfacePtr FakeUIFactory::create() {
+    FakeScope scope;
+    return AskUIInterfacePtr(new FakeUI(*this, m_nextId++));
+}
+
+} // namespace Test
+
+} // namespace AskUser
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+/**
+ * @file        FakeUI.h
+ * @author      Adam Malinowski <a.malinowsk2@partner.samsung.com>
+ * @brief       This file declares UI answering prompts without user
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <vector>
+
+#include <ui/AskUIInterface.h>
+
+namespace AskUser {
+
+namespace Test {
+
+// What fake prompt does with a request
+struct FakeAnswer {
+    bool started;   // false if prompt fails to start
+    bool answered;  // false if prompt never answers
+    Agent::UIResponseType response;
+    std::chrono::steady_clock::duration delay;
+    std::chrono::steady_clock::duration startDelay; // start blocks that long, like slow prompt
+};
+
+typedef std::function<FakeAnswer(Agent::RequestId)> FakeAnswerPolicy;
+
+/*
+ * Every prompt answers from its own thread, after delay chosen by policy. Like thread of
+ * notification, it runs until the last answer is delivered, or until prompt expires if some
+ * request is never answered, no matter if prompt was dismissed in the meantime. Dismissal
+ * succeeds only once the thread has finished, so agent has to keep dismissed prompts.
+ */
+class FakeUIFactory : public Agent::AskUIFactory {
+public:
+    FakeUIFactory(FakeAnswerPolicy policy, std::chrono::seconds timeout);
+
+    virtual Agent::AskUIInterfacePtr create();
+
+    FakeAnswer answer(Agent::RequestId requestId) {
+        return m_policy(requestId);
+    }
+    std::chrono::seconds timeout() const {
+        return m_timeout;
+    }
+
+    // Prompts not destroyed yet and their threads still running
+    long liveUIs() const {
+        return m_liveUIs;
+    }
+    long liveThreads() const {
+        return m_liveThreads;
+    }
+
+private:
+    friend class FakeUI;
+
+    FakeAnswerPolicy m_policy;
+    std::chrono::seconds m_timeout;
+    std::atomic<int> m_nextId;
+    std::atomic<long> m_liveUIs;
+    std::atomic<long> m_liveThreads;
+};
+
+} // namespace Test
+
+} // namespace AskUser
@@ -0,0 +1,532 @@
+/*
+ *  Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License
+ */
+/**
+ * @file        main.cpp
+ * @author      Zofia Abramowska <z.abramowska@samsung.com>
+ * @brief       Host running askuser plugins outside of cynara, for benchmarking them
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+#include <cynara-client-plugin.h>
+#include <cynara-plugin.h>
+
+#include <state/PluginState.h>
+#include <translator/Translator.h>
+#include <types/AgentErrorMsg.h>
+#include <types/SupportedTypes.h>
+
+using namespace Cynara;
+using namespace AskUser;
+
+namespace {
+
+const char *const servicePluginPath = PLUGIN_DIR "/service/libaskuser-plugin-service.so";
+const char *const clientPluginPath = PLUGIN_DIR "/client/libaskuser-plugin-client.so";
+
+const char *const privileges[] = {
+    "http://tizen.org/privilege/account.read",
+    "http://tizen.org/privilege/calendar.read",
+    "http://tizen.org/privilege/camera",
+    "http://tizen.org/privilege/contact.read",
+    "http://tizen.org/privilege/location",
+    "http://tizen.org/privilege/recorder",
+};
+const unsigned privilegeCount = sizeof(privileges) / sizeof(privileges[0]);
+const unsigned userCount = 4;
+
+enum class Distribution {
+    Uniform,
+    Zipf,
+    Scan
+};
+
+struct Options {
+    const char *servicePath = servicePluginPath;
+    const char *clientPath = clientPluginPath;
+    Distribution distribution = Distribution::Zipf;
+    double skew = 0.99;
+    std::size_t keys = 10000;
+    std::size_t requests = 1000000;
+    unsigned threads = 1;
+    std::size_t invalidateEvery = 0;
+    unsigned lifetimePercent = 100;
+    bool bulk = false;
+};
+
+struct Key {
+    std::string client;
+    std::string user;
+    std::string privilege;
+};
+
+struct Counters {
+    std::uint64_t clientHits = 0;
+    std::uint64_t serviceHits = 0;
+    std::uint64_t agentAnswers = 0;
+    std::uint64_t errors = 0;
+    std::uint64_t invalidations = 0;
+    std::vector<std::uint32_t> latencies; // nanoseconds
+};
+
+// Loaded plugin library; instances are created through its create/destroy symbols
+class PluginLibrary {
+public:
+    explicit PluginLibrary(const char *path) : m_handle(dlopen(path, RTLD_NOW)),
+                                               m_create(nullptr), m_destroy(nullptr) {
+        if (!m_handle) {
+            fprintf(stderr, "Unable to load <%s>: %s\n", path, dlerror());
+            return;
+        }
+        m_create = reinterpret_cast<create_t>(dlsym(m_handle, "create"));
+        m_destroy = reinterpret_cast<destroy_t>(dlsym(m_handle, "destroy"));
+        if (!m_create || !m_destroy)
+            fprintf(stderr, "Plugin <%s> does not export create/destroy\n", path);
+    }
+
+    ~PluginLibrary() {
+        if (m_handle)
+            dlclose(m_handle);
+    }
+
+    bool loaded() const {
+        return m_create && m_destroy;
+    }
+
+    void *symbol(const char *name) const {
+        return dlsym(m_handle, name);
+    }
+
+    ExternalPluginInterface *create() const {
+        return m_create();
+    }
+
+    void destroy(ExternalPluginInterface *plugin) const {
+        m_destroy(plugin);
+    }
+
+private:
+    void *m_handle;
+    create_t m_create;
+    destroy_t m_destroy;
+};
+
+/*
+ * Cynara service calls its plugins from a single thread, so calls from all host threads are
+ * serialized the same way.
+ */
+class ServiceHost {
+public:
+    typedef int (*checkPrivileges_t)(ExternalPluginInterface *, const char *, const char *,
+                                     const char *const *, size_t, uint16_t *, uint32_t *,
+                                     size_t *, uint64_t *);
+
+    ServiceHost(const PluginLibrary &library, unsigned lifetimePercent)
+        : m_library(library),
+          m_plugin(dynamic_cast<ServicePluginInterface *>(library.create())),
+          m_checkPrivileges(reinterpret_cast<checkPrivileges_t>(
+              library.symbol("checkPrivileges"))),
+          m_lifetimePercent(lifetimePercent) {}
+
+    ~ServiceHost() {
+        m_library.destroy(m_plugin);
+    }
+
+    bool valid() const {
+        return m_plugin != nullptr;
+    }
+
+    bool hasBulkCheck() const {
+        return m_checkPrivileges != nullptr;
+    }
+
+    bool check(const Key &key, std::uint64_t sequence, PolicyResult &result, Counters &counters) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return checkLocked(key, sequence, result, counters);
+    }
+
+    // Privileges of one client and user are checked at once, those not cached one by one
+    bool checkAll(const Key *keys, std::size_t count, std::uint64_t sequence,
+                  Counters &counters) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_privileges.clear();
+        for (std::size_t i = 0; i < count; ++i)
+            m_privileges.push_back(keys[i].privilege.c_str());
+        m_types.resize(count);
+        m_misses.resize(count);
+        std::size_t missCount;
+        std::uint64_t epoch;
+        if (m_checkPrivileges(m_plugin, keys[0].client.c_str(), keys[0].user.c_str(),
+                              m_privileges.data(), count, m_types.data(), m_misses.data(),
+                              &missCount, &epoch) != 0)
+            return false;
+
+        counters.serviceHits += count - missCount;
+        for (std::size_t i = 0; i < missCount; ++i) {
+            std::size_t miss = m_misses[i];
+            PolicyResult result;
+            if (!checkLocked(keys[miss], sequence, result, counters))
+                return false;
+        }
+        return true;
+    }
+
+    void invalidate() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_plugin->invalidate();
+    }
+
+private:
+    const PluginLibrary &m_library;
+    ServicePluginInterface *m_plugin;
+    checkPrivileges_t m_checkPrivileges;
+    unsigned m_lifetimePercent;
+    std::mutex m_mutex;
+    std::vector<const char *> m_privileges;
+    std::vector<PolicyType> m_types;
+    std::vector<std::uint32_t> m_misses;
+
+    // Answers request, which service plugin cannot answer by itself, as agent would
+    bool checkLocked(const Key &key, std::uint64_t sequence, PolicyResult &result,
+                     Counters &counters) {
+        AgentType agent;
+        PluginData data;
+
+        auto status = m_plugin->check(key.client, key.user, key.privilege, result, agent, data);
+        if (status == ServicePluginInterface::PluginStatus::ANSWER_READY) {
+            ++counters.serviceHits;
+            return true;
+        }
+        if (status != ServicePluginInterface::PluginStatus::ANSWER_NOTREADY)
+            return false;
+
+        try {
+            Translator::Agent::dataToRequest(data);
+        } catch (const Translator::TranslateErrorException &e) {
+            fprintf(stderr, "Plugin sent malformed request: %s\n", e.what());
+            return false;
+        }
+        PolicyType answer = sequence % 100 < m_lifetimePercent
+                            ? SupportedTypes::Client::ALLOW_PER_LIFE
+                            : SupportedTypes::Client::ALLOW_ONCE;
+        PluginData agentData = Translator::Agent::answerToData(answer, AgentErrorMsg::NoError);
+        ++counters.agentAnswers;
+        return m_plugin->update(key.client, key.user, key.privilege, agentData, result)
+               == ServicePluginInterface::PluginStatus::SUCCESS;
+    }
+};
+
+// Draws indexes of keys; Zipf distribution uses precomputed cumulative probabilities
+class KeyGenerator {
+public:
+    KeyGenerator(const Options &options, unsigned thread)
+        : m_options(options), m_random(thread + 1), m_uniform(0, options.keys - 1),
+          m_next(options.keys * thread / options.threads) {}
+
+    static void prepareZipf(std::size_t keys, double skew) {
+        cdf().resize(keys);
+        double sum = 0;
+        for (std::size_t i = 0; i < keys; ++i) {
+            sum += 1.0 / std::pow(static_cast<double>(i + 1), skew);
+            cdf()[i] = sum;
+        }
+        for (auto &value : cdf())
+            value /= sum;
+    }
+
+    std::size_t next() {
+        switch (m_options.distribution) {
+        case Distribution::Uniform:
+            return m_uniform(m_random);
+        case Distribution::Zipf: {
+            double value = std::generate_canonical<double, 53>(m_random);
+            auto it = std::lower_bound(cdf().begin(), cdf().end(), value);
+            return std::min<std::size_t>(it - cdf().begin(), m_options.keys - 1);
+        }
+        case Distribution::Scan:
+            break;
+        }
+        m_next = (m_next + 1) % m_options.keys;
+        return m_next;
+    }
+
+private:
+    const Options &m_options;
+    std::mt19937_64 m_random;
+    std::uniform_int_distribution<std::size_t> m_uniform;
+    std::size_t m_next;
+
+    static std::vector<double> &cdf() {
+        static std::vector<double> values;
+        return values;
+    }
+};
+
+std::vector<Key> makeKeys(std::size_t count) {
+    std::vector<Key> keys(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        keys[i].client = "org.example.app" + std::to_string(i / (privilegeCount * userCount));
+        keys[i].user = std::to_string(5001 + (i / privilegeCount) % userCount);
+        keys[i].privilege = privileges[i % privilegeCount];
+    }
+    return keys;
+}
+
+/*
+ * Every thread acts as a separate client process: it has its own client plugin and cache of
+ * decisions and asks shared service only when cached decision is not usable.
+ */
+void runClient(const Options &options, unsigned thread, const std::vector<Key> &keys,
+               const PluginLibrary &clientLibrary, ServiceHost &service, Counters &counters) {
+    auto *client = dynamic_cast<ClientPluginInterface *>(clientLibrary.create());
+    if (!client) {
+        ++counters.errors;
+        return;
+    }
+
+    ClientSession session = "session" + std::to_string(thread);
+    std::unordered_map<std::size_t, PolicyResult> cache;
+    KeyGenerator generator(options, thread);
+    counters.latencies.reserve(options.requests);
+
+    for (std::size_t i = 0; i < options.requests; ++i) {
+        if (options.invalidateEvery && thread == 0 && i && i % options.invalidateEvery == 0) {
+            service.invalidate();
+            ++counters.invalidations;
+        }
+
+        std::size_t index = generator.next();
+        auto start = std::chrono::steady_clock::now();
+
+        // Launcher checks all privileges of application in service, bypassing client cache
+        bool answered = false;
+        if (options.bulk) {
+            std::size_t first = index - index % privilegeCount;
+            std::size_t count = std::min<std::size_t>(privilegeCount, keys.size() - first);
+            if (!service.checkAll(&keys[first], count, i, counters))
+                ++counters.errors;
+            answered = true;
+        }
+        auto cached = answered ? cache.end() : cache.find(index);
+        if (cached != cache.end()) {
+            bool updateSession;
+            PolicyResult result = cached->second;
+            if (client->isUsable(session, session, updateSession, result)) {
+                client->toResult(session, result);
+                ++counters.clientHits;
+                answered = true;
+            } else {
+                cache.erase(cached);
+            }
+        }
+
+        if (!answered) {
+            PolicyResult result;
+            if (!service.check(keys[index], i, result, counters)) {
+                ++counters.errors;
+            } else {
+                if (client->isCacheable(session, result))
+                    cache[index] = result;
+                client->toResult(session, result);
+            }
+        }
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now() - start).count();
+        counters.latencies.push_back(static_cast<std::uint32_t>(
+            std::min<std::int64_t>(elapsed, UINT32_MAX)));
+    }
+
+    clientLibrary.destroy(client);
+}
+
+double percentile(const std::vector<std::uint32_t> &sorted, double rank) {
+    if (sorted.empty())
+        return 0;
+    std::size_t index = static_cast<std::size_t>(rank * (sorted.size() - 1));
+    return sorted[index] / 1000.0;
+}
+
+void printReport(const Counters &total, double seconds) {
+    std::uint64_t requests = total.latencies.size();
+
+    printf("%-16s %" PRIu64 "\n", "requests:", requests);
+    printf("%-16s %.3f s\n", "time:", seconds);
+    printf("%-16s %.0f req/s\n", "throughput:", seconds > 0 ? requests / seconds : 0.0);
+    printf("%-16s p50 %.2f us, p90 %.2f us, p99 %.2f us, p99.9 %.2f us, max %.2f us\n",
+           "latency:", percentile(total.latencies, 0.5), percentile(total.latencies, 0.9),
+           percentile(total.latencies, 0.99), percentile(total.latencies, 0.999),
+           percentile(total.latencies, 1.0));
+    printf("%-16s %" PRIu64 "\n", "client hits:", total.clientHits);
+    printf("%-16s %" PRIu64 "\n", "service hits:", total.serviceHits);
+    printf("%-16s %" PRIu64 "\n", "agent answers:", total.agentAnswers);
+    printf("%-16s %" PRIu64 "\n", "invalidations:", total.invalidations);
+    printf("%-16s %" PRIu64 "\n", "errors:", total.errors);
+
+    const State::PluginState *state = State::mapPluginState(false);
+    if (!state) {
+        printf("Service plugin state is not available\n");
+        return;
+    }
+    const State::CacheStats &stats = state->cache;
+    std::uint64_t lookups = State::get(stats.hits) + State::get(stats.misses);
+    printf("%-16s %" PRIu64 " entries, %" PRIu64 " bytes\n", "service cache:",
+           State::get(stats.size), State::get(stats.bytes));
+    printf("%-16s %.2f%%\n", "hit ratio:",
+           lookups ? 100.0 * State::get(stats.hits) / lookups : 0.0);
+    printf("%-16s %" PRIu64 "\n", "evictions:", State::get(stats.evictions));
+    printf("%-16s %" PRIu64 "\n", "expirations:", State::get(stats.expirations));
+    State::unmapPluginState(state);
+}
+
+void usage(const char *name) {
+    printf("Usage: %s [options]\n"
+           "  -s <path>     service plugin (default %s)\n"
+           "  -c <path>     client plugin (default %s)\n"
+           "  -d <name>     key distribution: zipf, uniform or scan (default zipf)\n"
+           "  -z <skew>     skew of zipf distribution (default 0.99)\n"
+           "  -k <count>    number of distinct keys (default 10000)\n"
+           "  -n <count>    requests per thread (default 1000000)\n"
+           "  -t <count>    number of client threads (default 1)\n"
+           "  -i <count>    invalidate service plugin every <count> requests (default never)\n"
+           "  -l <percent>  percent of agent answers valid per life (default 100)\n"
+           "  -b            check all privileges of client and user of drawn key at once\n",
+           name, servicePluginPath, clientPluginPath);
+}
+
+bool parseOptions(int argc, char **argv, Options &options) {
+    int opt;
+    while ((opt = getopt(argc, argv, "s:c:d:z:k:n:t:i:l:bh")) != -1) {
+        switch (opt) {
+        case 's':
+            options.servicePath = optarg;
+            break;
+        case 'c':
+            options.clientPath = optarg;
+            break;
+        case 'd':
+            if (!strcmp(optarg, "zipf")) {
+                options.distribution = Distribution::Zipf;
+            } else if (!strcmp(optarg, "uniform")) {
+                options.distribution = Distribution::Uniform;
+            } else if (!strcmp(optarg, "scan")) {
+                options.distribution = Distribution::Scan;
+            } else {
+                fprintf(stderr, "Unknown distribution <%s>\n", optarg);
+                return false;
+            }
+            break;
+        case 'z':
+            options.skew = strtod(optarg, nullptr);
+            break;
+        case 'k':
+            options.keys = strtoull(optarg, nullptr, 10);
+            break;
+        case 'n':
+            options.requests = strtoull(optarg, nullptr, 10);
+            break;
+        case 't':
+            options.threads = strtoul(optarg, nullptr, 10);
+            break;
+        case 'i':
+            options.invalidateEvery = strtoull(optarg, nullptr, 10);
+            break;
+        case 'l':
+            options.lifetimePercent = std::min(100ul, strtoul(optarg, nullptr, 10));
+            break;
+        case 'b':
+            options.bulk = true;
+            break;
+        default:
+            usage(argv[0]);
+            return false;
+        }
+    }
+    if (!options.keys || !options.threads) {
+        fprintf(stderr, "Number of keys and threads must be positive\n");
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options))
+        return EXIT_FAILURE;
+
+    PluginLibrary serviceLibrary(options.servicePath);
+    PluginLibrary clientLibrary(options.clientPath);
+    if (!serviceLibrary.loaded() || !clientLibrary.loaded())
+        return EXIT_FAILURE;
+
+    ServiceHost service(serviceLibrary, options.lifetimePercent);
+    if (!service.valid()) {
+        fprintf(stderr, "Service plugin does not implement ServicePluginInterface\n");
+        return EXIT_FAILURE;
+    }
+    if (options.bulk && !service.hasBulkCheck()) {
+        fprintf(stderr, "Service plugin does not export checkPrivileges\n");
+        return EXIT_FAILURE;
+    }
+
+    std::vector<Key> keys = makeKeys(options.keys);
+    if (options.distribution == Distribution::Zipf)
+        KeyGenerator::prepareZipf(options.keys, options.skew);
+
+    std::vector<Counters> counters(options.threads);
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < options.threads; ++i) {
+        threads.push_back(std::thread(runClient, std::cref(options), i, std::cref(keys),
+                                      std::cref(clientLibrary), std::ref(service),
+                                      std::ref(counters[i])));
+    }
+    for (auto &thread : threads)
+        thread.join();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    Counters total;
+    for (const auto &threadCounters : counters) {
+        total.clientHits += threadCounters.clientHits;
+        total.serviceHits += threadCounters.serviceHits;
+        total.agentAnswers += threadCounters.agentAnswers;
+        total.errors += threadCounters.errors;
+        total.invalidations += threadCounters.invalidations;
+        total.latencies.insert(total.latencies.end(), threadCounters.latencies.begin(),
+                               threadCounters.latencies.end());
+    }
+    std::sort(total.latencies.begin(), total.latencies.end());
+
+    printReport(total, elapsed.count());
+    return total.errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,344 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+/**
+ * @file        main.cpp
+ * @author      Adam Malinowski <a.malinowsk2@partner.samsung.com>
+ * @brief       Replays recorded trace of cynara requests against agent
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include <translator/Translator.h>
+#include <types/AgentErrorMsg.h>
+#include <types/SupportedTypes.h>
+
+#include <log/alog.h>
+#include <main/Agent.h>
+#include <main/RequestTrace.h>
+
+#include "FakeCynara.h"
+#include "FakeUI.h"
+
+using namespace AskUser;
+using namespace AskUser::Agent;
+using AskUser::Test::FakeAnswer;
+using AskUser::Test::FakeCynara;
+using AskUser::Test::FakeUIFactory;
+
+namespace {
+
+// Request from trace together with response which agent gave to it when trace was recorded
+struct ReplayedRequest {
+    TraceRecord request;
+    bool recorded;
+    TraceEvent responseEvent;
+    Cynara::PluginData answer;
+    std::chrono::nanoseconds delay;
+};
+
+struct InFlight {
+    std::size_t index;
+    std::chrono::steady_clock::time_point sent;
+};
+
+struct Options {
+    double speed = 1.0; // 0 means as fast as possible
+    unsigned wait = 5;  // seconds
+    const char *path = nullptr;
+};
+
+std::vector<TraceRecord> records;
+std::vector<ReplayedRequest> requests;
+Options options;
+
+std::mutex mutex;
+std::condition_variable answered;
+std::map<RequestId, InFlight> inFlight;
+std::vector<double> latencies; // microseconds
+std::size_t matching = 0;
+std::size_t mismatching = 0;
+std::size_t unexpected = 0;
+std::size_t duplicates = 0;
+
+bool loadTrace(const char *path) {
+    RequestTraceReader reader;
+    if (!reader.open(path)) {
+        fprintf(stderr, "Unable to open trace <%s>\n", path);
+        return false;
+    }
+
+    std::map<RequestId, std::size_t> open;
+    TraceRecord record;
+    while (reader.next(record)) {
+        if (record.event == TraceEvent::Request) {
+            if (open.count(record.id)) {
+                // Agent rejected it when trace was recorded, as the ID was still in use
+                ++duplicates;
+                continue;
+            }
+            ReplayedRequest replayed;
+            replayed.request = record;
+            replayed.recorded = false;
+            open[record.id] = requests.size();
+            requests.push_back(replayed);
+        } else if (record.event == TraceEvent::Response
+                   || record.event == TraceEvent::CancelResponse) {
+            auto it = open.find(record.id);
+            if (it == open.end())
+                continue;
+            ReplayedRequest &replayed = requests[it->second];
+            replayed.recorded = true;
+            replayed.responseEvent = record.event;
+            replayed.answer = record.answer;
+            replayed.delay = record.time - replayed.request.time;
+            open.erase(it);
+        }
+        records.push_back(record);
+    }
+    return true;
+}
+
+UIResponseType toUIResponse(const Cynara::PluginData &answer) {
+    if (answer == AgentErrorMsg::Error)
+        return URT_ERROR;
+    if (answer == AgentErrorMsg::Timeout)
+        return URT_TIMEOUT;
+
+    switch (Translator::Plugin::dataToAnswer(answer)) {
+    case SupportedTypes::Client::ALLOW_ONCE:
+        return URT_YES_ONCE;
+    case SupportedTypes::Client::ALLOW_PER_SESSION:
+        return URT_YES_SESSION;
+    case SupportedTypes::Client::ALLOW_PER_LIFE:
+        return URT_YES_LIFE;
+    case SupportedTypes::Client::DENY_PER_SESSION:
+        return URT_NO_SESSION;
+    case SupportedTypes::Client::DENY_PER_LIFE:
+        return URT_NO_LIFE;
+    default:
+        return URT_NO_ONCE;
+    }
+}
+
+template <typename Duration>
+std::chrono::steady_clock::duration scaled(Duration duration) {
+    if (options.speed <= 0)
+        return std::chrono::steady_clock::duration::zero();
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double, std::nano>(duration) / options.speed);
+}
+
+// Prompt gives answer which user gave when trace was recorded, after the same time
+FakeAnswer answerAsRecorded(RequestId id) {
+    FakeAnswer answer{true, false, URT_ERROR, std::chrono::steady_clock::duration::zero(),
+                      std::chrono::steady_clock::duration::zero()};
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = inFlight.find(id);
+    if (it == inFlight.end())
+        return answer;
+    const ReplayedRequest &replayed = requests[it->second.index];
+    if (!replayed.recorded || replayed.responseEvent != TraceEvent::Response)
+        return answer;
+
+    try {
+        answer.response = toUIResponse(replayed.answer);
+    } catch (const Translator::TranslateErrorException &e) {
+        answer.response = URT_ERROR;
+    }
+    answer.answered = true;
+    answer.delay = scaled(replayed.delay);
+    return answer;
+}
+
+void handleResponse(cynara_agent_msg_type type, cynara_agent_req_id id,
+                    const std::string &data) {
+    auto now = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = inFlight.find(id);
+    if (it == inFlight.end()) {
+        ++unexpected;
+        return;
+    }
+    const ReplayedRequest &replayed = requests[it->second.index];
+    bool match = replayed.recorded
+                 && ((type == CYNARA_MSG_TYPE_CANCEL
+                      && replayed.responseEvent == TraceEvent::CancelResponse)
+                     || (type == CYNARA_MSG_TYPE_ACTION
+                         && replayed.responseEvent == TraceEvent::Response
+                         && data == replayed.answer));
+    if (match)
+        ++matching;
+    else
+        ++mismatching;
+    latencies.push_back(std::chrono::duration<double, std::micro>(now - it->second.sent).count());
+    inFlight.erase(it);
+    answered.notify_all();
+}
+
+void replay() {
+    std::size_t next = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto &record : records) {
+        if (record.event != TraceEvent::Request && record.event != TraceEvent::Cancel)
+            continue;
+        if (options.speed > 0)
+            std::this_thread::sleep_until(start + scaled(record.time));
+
+        if (record.event == TraceEvent::Cancel) {
+            FakeCynara::instance().send(CYNARA_MSG_TYPE_CANCEL, record.id);
+            continue;
+        }
+
+        const RequestData &request = requests[next].request.request;
+        {
+            // Cynara reuses ID only after request was answered, replay faster than trace must
+            // not break that
+            std::unique_lock<std::mutex> lock(mutex);
+            answered.wait_for(lock, std::chrono::seconds(options.wait),
+                              [&record] { return !inFlight.count(record.id); });
+            inFlight[record.id] = InFlight{next, std::chrono::steady_clock::now()};
+        }
+        ++next;
+        FakeCynara::instance().send(CYNARA_MSG_TYPE_ACTION, record.id,
+                                    Translator::Plugin::requestToData(request.client,
+                                                                      request.user,
+                                                                      request.privilege));
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    answered.wait_for(lock, std::chrono::seconds(options.wait), [] { return inFlight.empty(); });
+}
+
+double percentile(const std::vector<double> &sorted, double rank) {
+    if (sorted.empty())
+        return 0;
+    return sorted[static_cast<std::size_t>(rank * (sorted.size() - 1))];
+}
+
+void printReport(double seconds) {
+    std::vector<double> recorded;
+    for (const auto &replayed : requests) {
+        if (replayed.recorded)
+            recorded.push_back(std::chrono::duration<double, std::micro>(replayed.delay).count());
+    }
+    std::sort(recorded.begin(), recorded.end());
+    std::sort(latencies.begin(), latencies.end());
+
+    double traced = records.empty()
+                    ? 0 : std::chrono::duration<double>(records.back().time).count();
+    printf("%-18s %zu (%zu with ID in use skipped)\n", "requests:", requests.size(),
+           duplicates);
+    printf("%-18s %.3f s traced, %.3f s replayed\n", "time:", traced, seconds);
+    printf("%-18s %zu matching, %zu different, %zu missing, %zu unexpected\n", "responses:",
+           matching, mismatching, inFlight.size(), unexpected);
+    printf("%-18s p50 %.1f us, p90 %.1f us, p99 %.1f us, max %.1f us\n", "recorded latency:",
+           percentile(recorded, 0.5), percentile(recorded, 0.9), percentile(recorded, 0.99),
+           percentile(recorded, 1.0));
+    printf("%-18s p50 %.1f us, p90 %.1f us, p99 %.1f us, max %.1f us\n", "replayed latency:",
+           percentile(latencies, 0.5), percentile(latencies, 0.9), percentile(latencies, 0.99),
+           percentile(latencies, 1.0));
+}
+
+void usage(const char *name) {
+    printf("Usage: %s [-s <speed>] [-w <seconds>] <trace>\n"
+           "  -s <speed>    replay speed, 1 is real time, 0 as fast as possible (default 1)\n"
+           "  -w <seconds>  time to wait for answers after last request (default 5)\n"
+           "Trace is recorded by agent started with ASKUSER_TRACE=<trace>.\n", name);
+}
+
+bool parseOptions(int argc, char **argv) {
+    int opt;
+    while ((opt = getopt(argc, argv, "s:w:h")) != -1) {
+        switch (opt) {
+        case 's':
+            options.speed = strtod(optarg, nullptr);
+            break;
+        case 'w':
+            options.wait = strtoul(optarg, nullptr, 10);
+            break;
+        default:
+            usage(argv[0]);
+            return false;
+        }
+    }
+    if (optind != argc - 1) {
+        usage(argv[0]);
+        return false;
+    }
+    options.path = argv[optind];
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    init_agent_log();
+
+    if (!parseOptions(argc, argv) || !loadTrace(options.path))
+        return EXIT_FAILURE;
+
+    // Prompts and audit log of agent on this device must not be touched
+    char snapshotDir[] = "/tmp/askuser-replay-XXXXXX";
+    if (!mkdtemp(snapshotDir)) {
+        perror("mkdtemp");
+        return EXIT_FAILURE;
+    }
+    std::string snapshot = std::string(snapshotDir) + "/prompts";
+    setenv("ASKUSER_SNAPSHOT", snapshot.c_str(), 0);
+    setenv("ASKUSER_AUDIT_LOG", "", 0);
+
+    FakeCynara::instance().setResponseHandler(handleResponse);
+    // Prompt of request not answered in trace expires, so its thread is over before agent stops
+    FakeUIFactory uiFactory(answerAsRecorded, std::chrono::seconds(options.wait));
+
+    double seconds;
+    {
+        AskUser::Agent::Agent agent(uiFactory);
+        if (!agent.start())
+            return EXIT_FAILURE;
+        std::thread agentThread(&AskUser::Agent::Agent::run, &agent);
+
+        auto start = std::chrono::steady_clock::now();
+        replay();
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(options.wait + 1);
+        while (uiFactory.liveThreads() && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        FakeCynara::instance().close();
+        agentThread.join();
+    }
+    unlink(snapshot.c_str());
+    rmdir(snapshotDir);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    printReport(seconds);
+    return mismatching || !inFlight.empty() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
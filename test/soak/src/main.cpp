@@ -0,0 +1,579 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+/**
+ * @file        main.cpp
+ * @author      Adam Malinowski <a.malinowsk2@partner.samsung.com>
+ * @brief       Soak test running agent over millions of requests and watching its resources
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <malloc.h>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include <translator/Translator.h>
+#include <types/AgentErrorMsg.h>
+#include <types/SupportedTypes.h>
+
+#include <log/alog.h>
+#include <main/Agent.h>
+
+#include "FakeCynara.h"
+#include "FakeUI.h"
+
+using namespace AskUser;
+using namespace AskUser::Agent;
+using AskUser::Test::FakeAnswer;
+using AskUser::Test::FakeCynara;
+using AskUser::Test::FakeUIFactory;
+
+namespace {
+
+// What happens to a request, chosen randomly when it is sent
+enum class Fate {
+    Answered,   // user answers prompt
+    TimedOut,   // prompt times out
+    Failed,     // prompt fails to start
+    UIError,    // prompt reports error
+    Unanswered, // prompt never answers, agent gives up at its deadline
+    Cancelled,  // prompt never answers, cynara cancels request
+    Malformed,  // request data cannot be decoded
+    Count
+};
+
+const char *const fateNames[] = {
+    "answered", "timed out", "failed", "ui error", "unanswered", "cancelled", "malformed"
+};
+
+// Agent waits that long after prompt expires, before it answers with timeout itself
+const unsigned deadlineGrace = 5;
+
+struct Options {
+    unsigned long requests = 1000000;
+    unsigned parallel = 64;
+    unsigned long interval = 100000;
+    unsigned timeout = 1;              // seconds
+    unsigned cancelPercent = 5;
+    unsigned errorPercent = 5;         // split between failed, ui error and malformed
+    unsigned timeoutPercent = 5;
+    unsigned unansweredPer100k = 10;
+    long maxThreadGrowth = 0;
+    long maxFdGrowth = 0;
+    long maxRssGrowth = 8192;          // KiB
+    long maxHeapGrowth = 4096;         // KiB
+    unsigned seed = 0;
+    unsigned blockedStart = 2000;      // milliseconds
+};
+
+struct Slot {
+    bool busy;
+    Fate fate;
+    UIResponseType response;
+    std::chrono::milliseconds startDelay;
+};
+
+struct Usage {
+    long threads;   // besides threads of prompts
+    long fds;
+    long rss;       // KiB
+    long heap;      // KiB
+    long uis;       // prompts not destroyed by agent
+    long uiThreads; // threads of prompts still running
+};
+
+Options options;
+FakeUIFactory *uiFactory;
+
+std::mutex mutex;
+std::condition_variable freed;
+std::vector<Slot> slots;
+std::vector<RequestId> freeIds;
+std::mt19937 answerRandom;
+unsigned long fates[static_cast<int>(Fate::Count)];
+unsigned long responses = 0;
+unsigned long wrong = 0;
+unsigned long unexpected = 0;
+
+Cynara::PluginData allowAnswer;
+Cynara::PluginData denyAnswer;
+Cynara::PluginData timeoutAnswer;
+Cynara::PluginData errorAnswer;
+
+long statusField(const char *name) {
+    FILE *status = fopen("/proc/self/status", "r");
+    if (!status)
+        return -1;
+    char line[256];
+    long value = -1;
+    std::size_t length = strlen(name);
+    while (fgets(line, sizeof(line), status)) {
+        if (!strncmp(line, name, length) && line[length] == ':') {
+            value = strtol(line + length + 1, nullptr, 10);
+            break;
+        }
+    }
+    fclose(status);
+    return value;
+}
+
+long openFds() {
+    DIR *dir = opendir("/proc/self/fd");
+    if (!dir)
+        return -1;
+    long count = 0;
+    while (struct dirent *entry = readdir(dir)) {
+        if (entry->d_name[0] != '.')
+            ++count;
+    }
+    closedir(dir);
+    // Descriptor of directory itself is not agent's
+    return count - 1;
+}
+
+long heapInUse() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    return static_cast<long>(mallinfo2().uordblks / 1024);
+#else
+    return mallinfo().uordblks / 1024;
+#endif
+}
+
+Usage sampleUsage() {
+    long uiThreads = uiFactory->liveThreads();
+    return Usage{statusField("Threads") - uiThreads, openFds(), statusField("VmRSS"), heapInUse(),
+                 uiFactory->liveUIs(), uiThreads};
+}
+
+void printUsage(const char *label, const Usage &usage, std::size_t inFlight) {
+    printf("%-12s %9zu %8ld %6ld %10ld %10ld %6ld %10ld\n", label, inFlight, usage.threads,
+           usage.fds, usage.rss, usage.heap, usage.uis, usage.uiThreads);
+    fflush(stdout);
+}
+
+Fate chooseFate(std::mt19937 &random) {
+    std::uniform_int_distribution<unsigned> percent(0, 99);
+    std::uniform_int_distribution<unsigned> per100k(0, 99999);
+    if (per100k(random) < options.unansweredPer100k)
+        return Fate::Unanswered;
+
+    unsigned roll = percent(random);
+    if (roll < options.cancelPercent)
+        return Fate::Cancelled;
+    roll -= options.cancelPercent;
+    if (roll < options.timeoutPercent)
+        return Fate::TimedOut;
+    roll -= options.timeoutPercent;
+    if (roll < options.errorPercent) {
+        switch (roll % 3) {
+        case 0:
+            return Fate::Failed;
+        case 1:
+            return Fate::UIError;
+        default:
+            return Fate::Malformed;
+        }
+    }
+    return Fate::Answered;
+}
+
+FakeAnswer answerByFate(RequestId id) {
+    std::uniform_int_distribution<unsigned> delay(0, 1000);
+    FakeAnswer answer{true, true, URT_ERROR, std::chrono::microseconds(0),
+                      std::chrono::microseconds(0)};
+
+    std::lock_guard<std::mutex> lock(mutex);
+    answer.delay = std::chrono::microseconds(delay(answerRandom));
+    const Slot &slot = slots[id];
+    answer.startDelay = slot.startDelay;
+    switch (slot.fate) {
+    case Fate::Answered:
+        answer.response = slot.response;
+        break;
+    case Fate::TimedOut:
+        answer.response = URT_TIMEOUT;
+        break;
+    case Fate::Failed:
+        answer.started = false;
+        break;
+    case Fate::Unanswered:
+    case Fate::Cancelled:
+        answer.answered = false;
+        break;
+    default:
+        break;
+    }
+    return answer;
+}
+
+void handleResponse(cynara_agent_msg_type type, cynara_agent_req_id id,
+                    const std::string &data) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (id >= slots.size() || !slots[id].busy) {
+        ++unexpected;
+        return;
+    }
+
+    Slot &slot = slots[id];
+    const Cynara::PluginData *expected = &errorAnswer;
+    switch (slot.fate) {
+    case Fate::Answered:
+        expected = slot.response == URT_YES_ONCE ? &allowAnswer : &denyAnswer;
+        break;
+    case Fate::TimedOut:
+    case Fate::Unanswered:
+        expected = &timeoutAnswer;
+        break;
+    default:
+        break;
+    }
+    bool correct = slot.fate == Fate::Cancelled
+                   ? type == CYNARA_MSG_TYPE_CANCEL
+                   : type == CYNARA_MSG_TYPE_ACTION && data == *expected;
+    if (!correct) {
+        ++wrong;
+        fprintf(stderr, "Wrong response to %s request [%u]\n",
+                fateNames[static_cast<int>(slot.fate)], id);
+    }
+
+    ++responses;
+    slot.busy = false;
+    freeIds.push_back(id);
+    freed.notify_one();
+}
+
+// Prompts of user flooding agent, all of them taking long to start
+const RequestId blockedPrompts = 4;
+
+/*
+ * Prompts of one user, which take long to start, must not delay prompt of another user.
+ * Answers of all requests are checked by handleResponse() as usual.
+ */
+bool checkIsolation() {
+    const RequestId other = blockedPrompts;
+    const std::chrono::milliseconds startDelay(options.blockedStart);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        freeIds.erase(std::remove_if(freeIds.begin(), freeIds.end(), [other](RequestId id) {
+                                         return id <= other;
+                                     }),
+                      freeIds.end());
+        for (RequestId id = 0; id < blockedPrompts; ++id)
+            slots[id] = Slot{true, Fate::Answered, URT_YES_ONCE, startDelay};
+        slots[other] = Slot{true, Fate::Answered, URT_NO_ONCE, std::chrono::milliseconds(0)};
+    }
+
+    Cynara::PluginData blocked = Translator::Plugin::requestToData("org.tizen.blocked", "5101",
+                                     "http://tizen.org/privilege/camera");
+    for (RequestId id = 0; id < blockedPrompts; ++id)
+        FakeCynara::instance().send(CYNARA_MSG_TYPE_ACTION, id, blocked);
+    // Prompts of blocked user are being started, when request of other user comes
+    std::this_thread::sleep_for(startDelay / 10);
+    auto sent = std::chrono::steady_clock::now();
+    FakeCynara::instance().send(CYNARA_MSG_TYPE_ACTION, other,
+                                Translator::Plugin::requestToData("org.tizen.other", "5102",
+                                    "http://tizen.org/privilege/camera"));
+
+    std::unique_lock<std::mutex> lock(mutex);
+    bool answered = freed.wait_for(lock, startDelay / 2, [other] { return !slots[other].busy; });
+    long waited = std::chrono::duration_cast<std::chrono::milliseconds>(
+                      std::chrono::steady_clock::now() - sent).count();
+    // Prompts of blocked user are started one after another in the worst case
+    freed.wait_for(lock, startDelay * blockedPrompts
+                         + std::chrono::seconds(options.timeout + deadlineGrace),
+                   [] { return freeIds.size() == options.parallel; });
+    for (RequestId id = 0; id < blockedPrompts; ++id)
+        slots[id].startDelay = std::chrono::milliseconds(0);
+    // Only requests of soak itself are counted
+    responses = 0;
+    printf("%s%u prompts starting for %u ms delayed other user by %ld ms\n",
+           answered ? "" : "FAILED: ", blockedPrompts, options.blockedStart, waited);
+    return answered;
+}
+
+/*
+ * Requests are sent while there is a free ID, so at most options.parallel are in flight,
+ * the same way cynara reuses IDs of answered requests.
+ */
+Usage soak(Usage &baseline) {
+    std::mt19937 random(options.seed);
+    std::uniform_int_distribution<unsigned> cancelDelay(0, 5000);
+    std::uniform_int_distribution<unsigned> answer(0, 1);
+
+    // Several users, so requests are spread over user workers of agent
+    std::vector<Cynara::PluginData> payloads;
+    for (unsigned id = 0; id < options.parallel; ++id) {
+        payloads.push_back(Translator::Plugin::requestToData(
+            "org.tizen.soak" + std::to_string(id), std::to_string(5001 + id % 3),
+            "http://tizen.org/privilege/camera"));
+    }
+    const std::string malformed("malformed");
+
+    printf("%-12s %9s %8s %6s %10s %10s %6s %10s\n", "requests", "in flight", "threads", "fds",
+           "rss KiB", "heap KiB", "uis", "ui threads");
+    baseline = sampleUsage();
+    printUsage("0", baseline, 0);
+
+    std::multimap<std::chrono::steady_clock::time_point, RequestId> cancels;
+    unsigned long sent = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (sent < options.requests || !cancels.empty()) {
+        auto now = std::chrono::steady_clock::now();
+        if (!cancels.empty() && cancels.begin()->first <= now) {
+            RequestId id = cancels.begin()->second;
+            cancels.erase(cancels.begin());
+            lock.unlock();
+            FakeCynara::instance().send(CYNARA_MSG_TYPE_CANCEL, id);
+            lock.lock();
+            continue;
+        }
+        if (sent == options.requests || freeIds.empty()) {
+            if (cancels.empty())
+                freed.wait(lock);
+            else
+                freed.wait_until(lock, cancels.begin()->first);
+            continue;
+        }
+
+        RequestId id = freeIds.back();
+        freeIds.pop_back();
+        Slot &slot = slots[id];
+        slot.busy = true;
+        slot.fate = chooseFate(random);
+        slot.response = answer(random) ? URT_YES_ONCE : URT_NO_ONCE;
+        ++fates[static_cast<int>(slot.fate)];
+        if (slot.fate == Fate::Cancelled)
+            cancels.insert(std::make_pair(now + std::chrono::microseconds(cancelDelay(random)),
+                                          id));
+        const std::string &data = slot.fate == Fate::Malformed ? malformed : payloads[id];
+        ++sent;
+        lock.unlock();
+
+        FakeCynara::instance().send(CYNARA_MSG_TYPE_ACTION, id, data);
+        if (sent % options.interval == 0) {
+            Usage usage = sampleUsage();
+            lock.lock();
+            std::size_t inFlight = options.parallel - freeIds.size();
+            lock.unlock();
+            printUsage(std::to_string(sent).c_str(), usage, inFlight);
+            // Agent reaches its steady state during first interval
+            if (sent == options.interval)
+                baseline = usage;
+        }
+        lock.lock();
+    }
+
+    freed.wait_for(lock, std::chrono::seconds(options.timeout + deadlineGrace + 5),
+                   [] { return freeIds.size() == options.parallel; });
+    std::size_t inFlight = options.parallel - freeIds.size();
+    lock.unlock();
+
+    // Prompts of cancelled and unanswered requests run until they expire, then agent has to
+    // dismiss and destroy all of them
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(options.timeout)
+                    + std::chrono::seconds(1);
+    while ((uiFactory->liveUIs() || uiFactory->liveThreads())
+           && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    Usage usage = sampleUsage();
+    printUsage("drained", usage, inFlight);
+    return usage;
+}
+
+bool checkGrowth(const char *name, long baseline, long final, long limit) {
+    long growth = final - baseline;
+    if (growth <= limit)
+        return true;
+    printf("FAILED: %s grew by %ld, limit is %ld\n", name, growth, limit);
+    return false;
+}
+
+void usage(const char *name) {
+    printf("Usage: %s [options]\n"
+           "  -n <count>    requests to send (default 1000000)\n"
+           "  -p <count>    requests in flight (default 64)\n"
+           "  -i <count>    requests between samples, first sample is baseline (default 100000)\n"
+           "  -t <seconds>  prompt timeout (default 1)\n"
+           "  -c <percent>  requests cancelled by cynara (default 5)\n"
+           "  -e <percent>  requests failing: prompt error, prompt not started or malformed"
+           " (default 5)\n"
+           "  -o <percent>  prompts timing out (default 5)\n"
+           "  -u <count>    requests per 100000 never answered by prompt (default 10)\n"
+           "  -T <count>    allowed growth of thread count (default 0)\n"
+           "  -F <count>    allowed growth of open fds (default 0)\n"
+           "  -R <KiB>      allowed growth of RSS (default 8192)\n"
+           "  -H <KiB>      allowed growth of heap in use (default 4096)\n"
+           "  -S <seed>     seed of random generator (default 0)\n"
+           "  -b <ms>       start of prompts of one user blocked, while other user is prompted;"
+           " 0 skips the check (default 2000)\n", name);
+}
+
+bool parseOptions(int argc, char **argv) {
+    int opt;
+    while ((opt = getopt(argc, argv, "n:p:i:t:c:e:o:u:T:F:R:H:S:b:h")) != -1) {
+        switch (opt) {
+        case 'n':
+            options.requests = strtoul(optarg, nullptr, 10);
+            break;
+        case 'p':
+            options.parallel = strtoul(optarg, nullptr, 10);
+            break;
+        case 'i':
+            options.interval = strtoul(optarg, nullptr, 10);
+            break;
+        case 't':
+            options.timeout = strtoul(optarg, nullptr, 10);
+            break;
+        case 'c':
+            options.cancelPercent = strtoul(optarg, nullptr, 10);
+            break;
+        case 'e':
+            options.errorPercent = strtoul(optarg, nullptr, 10);
+            break;
+        case 'o':
+            options.timeoutPercent = strtoul(optarg, nullptr, 10);
+            break;
+        case 'u':
+            options.unansweredPer100k = strtoul(optarg, nullptr, 10);
+            break;
+        case 'T':
+            options.maxThreadGrowth = strtol(optarg, nullptr, 10);
+            break;
+        case 'F':
+            options.maxFdGrowth = strtol(optarg, nullptr, 10);
+            break;
+        case 'R':
+            options.maxRssGrowth = strtol(optarg, nullptr, 10);
+            break;
+        case 'H':
+            options.maxHeapGrowth = strtol(optarg, nullptr, 10);
+            break;
+        case 'S':
+            options.seed = strtoul(optarg, nullptr, 10);
+            break;
+        case 'b':
+            options.blockedStart = strtoul(optarg, nullptr, 10);
+            break;
+        default:
+            usage(argv[0]);
+            return false;
+        }
+    }
+    if (optind != argc || options.parallel <= blockedPrompts || !options.interval
+            || options.cancelPercent + options.errorPercent + options.timeoutPercent > 100) {
+        usage(argv[0]);
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    init_agent_log();
+
+    if (!parseOptions(argc, argv))
+        return EXIT_FAILURE;
+
+    // Prompts and audit log of agent on this device must not be touched
+    char snapshotDir[] = "/tmp/askuser-soak-XXXXXX";
+    if (!mkdtemp(snapshotDir)) {
+        perror("mkdtemp");
+        return EXIT_FAILURE;
+    }
+    std::string snapshot = std::string(snapshotDir) + "/prompts";
+    setenv("ASKUSER_SNAPSHOT", snapshot.c_str(), 0);
+    setenv("ASKUSER_AUDIT_LOG", "", 0);
+    // Every request gets its own prompt, so its fate does not depend on others
+    setenv("ASKUSER_BATCH_WINDOW_MS", "0", 0);
+
+    allowAnswer = Translator::Agent::answerToData(SupportedTypes::Client::ALLOW_ONCE,
+                                                  AgentErrorMsg::NoError);
+    denyAnswer = Translator::Agent::answerToData(SupportedTypes::Client::DENY_ONCE,
+                                                 AgentErrorMsg::NoError);
+    timeoutAnswer = Translator::Agent::answerToData(Cynara::PolicyType(), AgentErrorMsg::Timeout);
+    errorAnswer = Translator::Agent::answerToData(Cynara::PolicyType(), AgentErrorMsg::Error);
+
+    slots.resize(options.parallel, Slot{false, Fate::Answered, URT_ERROR,
+                                        std::chrono::milliseconds(0)});
+    for (RequestId id = options.parallel; id > 0; --id)
+        freeIds.push_back(id - 1);
+    answerRandom.seed(options.seed + 1);
+
+    FakeCynara::instance().setResponseHandler(handleResponse);
+    FakeUIFactory factory(answerByFate, std::chrono::seconds(options.timeout));
+    uiFactory = &factory;
+
+    bool isolated = true;
+    Usage baseline, final;
+    auto start = std::chrono::steady_clock::now();
+    {
+        AskUser::Agent::Agent agent(factory);
+        if (!agent.start())
+            return EXIT_FAILURE;
+        std::thread agentThread(&AskUser::Agent::Agent::run, &agent);
+
+        if (options.blockedStart)
+            isolated = checkIsolation();
+        final = soak(baseline);
+
+        FakeCynara::instance().close();
+        agentThread.join();
+    }
+    unlink(snapshot.c_str());
+    rmdir(snapshotDir);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                                   - start).count();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::size_t missing = options.parallel - freeIds.size();
+    printf("\n%lu requests in %.1f s (%.0f/s):", responses + missing, seconds,
+           (responses + missing) / seconds);
+    for (int fate = 0; fate < static_cast<int>(Fate::Count); ++fate)
+        printf(" %lu %s%s", fates[fate], fateNames[fate],
+               fate + 1 < static_cast<int>(Fate::Count) ? "," : "\n");
+    printf("responses: %lu, wrong: %lu, missing: %zu, unexpected: %lu\n", responses, wrong,
+           missing, unexpected);
+
+    bool passed = !wrong && !missing && !unexpected;
+    if (!passed)
+        printf("FAILED: agent did not answer every request correctly\n");
+    passed = checkGrowth("thread count", baseline.threads, final.threads,
+                         options.maxThreadGrowth) && passed;
+    passed = checkGrowth("open fds", baseline.fds, final.fds, options.maxFdGrowth) && passed;
+    passed = checkGrowth("RSS", baseline.rss, final.rss, options.maxRssGrowth) && passed;
+    passed = checkGrowth("heap in use", baseline.heap, final.heap,
+                         options.maxHeapGrowth) && passed;
+    // Nothing is in flight any more, so no prompt may be left behind
+    passed = checkGrowth("prompt count", 0, final.uis, 0) && passed;
+    passed = checkGrowth("prompt thread count", 0, final.uiThreads, 0) && passed;
+    passed = isolated && passed;
+    if (!passed)
+        return EXIT_FAILURE;
+    printf("PASSED\n");
+    return EXIT_SUCCESS;
+}